@@ -0,0 +1,188 @@
+/**
+ * @file ac.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Aho-Corasick automaton, searches many keywords in one pass over the input.
+ * @details The keywords are inserted into a trie, then the failure links are computed breadth first and every missing
+ *          transition is replaced by the transition of the failure state. The result is a complete table, the search
+ *          does exactly one table lookup per input byte and never follows a failure link.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "ac.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define AC_NONE UINT32_MAX /**< Marks a transition that is not set yet while building. */
+
+/**
+ * @brief folds an ascii upper case letter to lower case, every other byte stays the same
+ * @param c byte
+ * @return folded byte
+ */
+static unsigned char fold(unsigned char c){
+    return (c >= 'A' && c <= 'Z') ? (c | 0x20) : c;
+}
+
+/**
+ * @brief computes the byte classes. Every byte used in a keyword gets its own class, all other bytes share class 0
+ * @param ac automaton, cls and nclasses are set
+ * @param keywords keywords
+ * @param n number of keywords
+ * @param case_insensitive nonzero if upper case letters get the class of their lower case letter
+ */
+static void build_classes(ac_automaton *ac, char *const *keywords, size_t n, int case_insensitive){
+    unsigned char used[256] = {0};
+    int distinct = 0;
+    for(size_t k = 0; k < n; k++){
+        for(const unsigned char *p = (const unsigned char *) keywords[k]; *p != '\0'; p++){
+            unsigned char c = case_insensitive ? fold(*p) : *p;
+            if(!used[c]){
+                used[c] = 1;
+                distinct++;
+            }
+        }
+    }
+
+    // if every byte value is used there is no byte left for class 0
+    int next = (distinct == 256) ? 0 : 1;
+    for(int c = 0; c < 256; c++){
+        ac->cls[c] = used[c] ? (unsigned char) next++ : 0;
+    }
+    if(case_insensitive){
+        for(int c = 'A'; c <= 'Z'; c++) ac->cls[c] = ac->cls[c | 0x20];
+    }
+    ac->nclasses = (uint32_t) next;
+}
+
+int ac_build(ac_automaton *ac, char *const *keywords, size_t n, int case_insensitive){
+    memset(ac, 0, sizeof(*ac));
+    build_classes(ac, keywords, n, case_insensitive);
+
+    size_t max_states = 1;
+    for(size_t k = 0; k < n; k++){
+        size_t len = strlen(keywords[k]);
+        if(len == 0) ac->match_empty = 1;
+        max_states += len;
+    }
+    if(max_states > AC_NONE / ac->nclasses) return -1;
+
+    uint32_t ncls = ac->nclasses;
+    ac->delta = malloc(max_states * ncls * sizeof(uint32_t));
+    ac->out = calloc(max_states, sizeof(uint32_t));
+    ac->shorter = calloc(max_states, sizeof(uint32_t));
+    uint32_t *fail = malloc(max_states * sizeof(uint32_t));
+    uint32_t *queue = malloc(max_states * sizeof(uint32_t));
+    if(ac->delta == NULL || ac->out == NULL || ac->shorter == NULL || fail == NULL || queue == NULL){
+        free(fail);
+        free(queue);
+        ac_free(ac);
+        return -1;
+    }
+    memset(ac->delta, 0xff, max_states * ncls * sizeof(uint32_t)); // every transition AC_NONE
+
+    // trie
+    ac->nstates = 1;
+    for(size_t k = 0; k < n; k++){
+        uint32_t s = 0;
+        uint32_t depth = 0;
+        for(const unsigned char *p = (const unsigned char *) keywords[k]; *p != '\0'; p++){
+            uint32_t *t = &ac->delta[(size_t) s * ncls + ac->cls[*p]];
+            if(*t == AC_NONE) *t = ac->nstates++;
+            s = *t;
+            depth++;
+        }
+        if(depth > ac->out[s]) ac->out[s] = depth;
+    }
+
+    // failure links breadth first. A state's failure state is less deep, so its row is already complete when it is used.
+    size_t head = 0, tail = 0;
+    for(uint32_t c = 0; c < ncls; c++){
+        uint32_t *t = &ac->delta[c];
+        if(*t == AC_NONE){
+            *t = 0;
+        } else {
+            fail[*t] = 0;
+            queue[tail++] = *t;
+        }
+    }
+    while(head < tail){
+        uint32_t s = queue[head++];
+        const uint32_t *frow = &ac->delta[(size_t) fail[s] * ncls];
+        uint32_t *row = &ac->delta[(size_t) s * ncls];
+        // a keyword that ends in the failure state ends here too, after the keyword of this state if there is one
+        if(ac->out[s] == 0){
+            ac->out[s] = ac->out[fail[s]];
+            ac->shorter[s] = ac->shorter[fail[s]];
+        } else {
+            ac->shorter[s] = fail[s];
+        }
+        for(uint32_t c = 0; c < ncls; c++){
+            if(row[c] == AC_NONE){
+                row[c] = frow[c];
+            } else {
+                fail[row[c]] = frow[c];
+                queue[tail++] = row[c];
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+void ac_free(ac_automaton *ac){
+    free(ac->delta);
+    free(ac->out);
+    free(ac->shorter);
+    ac->delta = NULL;
+    ac->out = NULL;
+    ac->shorter = NULL;
+}
+
+const char *ac_find(const ac_automaton *ac, const char *haystack, size_t len, size_t *match_len){
+    if(ac->match_empty){
+        *match_len = 0;
+        return haystack;
+    }
+
+    const uint32_t *delta = ac->delta;
+    const uint32_t *out = ac->out;
+    const unsigned char *cls = ac->cls;
+    const size_t ncls = ac->nclasses;
+    uint32_t s = 0;
+
+    for(size_t i = 0; i < len; i++){
+        s = delta[s * ncls + cls[(unsigned char) haystack[i]]];
+        if(out[s] != 0){
+            *match_len = out[s];
+            return haystack + i + 1 - out[s];
+        }
+    }
+    return NULL;
+}
+
+const char *ac_find_accepted(const ac_automaton *ac, const char *haystack, size_t len, ac_accept accept, const void *ctx, size_t *match_len){
+    const uint32_t *delta = ac->delta;
+    const uint32_t *out = ac->out;
+    const unsigned char *cls = ac->cls;
+    const size_t ncls = ac->nclasses;
+    uint32_t s = 0;
+
+    for(size_t i = 0; ; i++){
+        // all keywords that end before haystack[i], the root has no keyword and ends the chain
+        for(uint32_t t = s; out[t] != 0; t = ac->shorter[t]){
+            if(accept(ctx, haystack + i - out[t], out[t])){
+                *match_len = out[t];
+                return haystack + i - out[t];
+            }
+        }
+        if(ac->match_empty && accept(ctx, haystack + i, 0)){
+            *match_len = 0;
+            return haystack + i;
+        }
+        if(i == len) return NULL;
+        s = delta[s * ncls + cls[(unsigned char) haystack[i]]];
+    }
+}
@@ -0,0 +1,82 @@
+/**
+ * @file ac.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Aho-Corasick automaton, searches many keywords in one pass over the input.
+ * @details The automaton is built once (ac_build) as a complete transition table. Input bytes are first mapped to a
+ *          byte class, every byte that occurs in no keyword shares class 0, so a table row only has as many entries as
+ *          there are distinct keyword bytes. This keeps the whole table small enough to stay in the cache.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef AC_H
+#define AC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Prepared set of keywords.
+ */
+typedef struct {
+    unsigned char cls[256]; /**< Byte class of every input byte. */
+    uint32_t nclasses; /**< Number of byte classes, length of a table row. */
+    uint32_t nstates; /**< Number of states, state 0 is the root. */
+    uint32_t *delta; /**< Transition table, next state of s on class c is delta[s * nclasses + c]. */
+    uint32_t *out; /**< Length of the longest keyword that ends in a state, 0 if none does. */
+    uint32_t *shorter; /**< State whose out is the next shorter keyword that ends in the same place, its out is 0 if there is none. */
+    int match_empty; /**< Nonzero if one of the keywords is empty, it matches everywhere. */
+} ac_automaton;
+
+/**
+ * @brief Builds the automaton for a set of keywords.
+ * @param ac automaton to initialize
+ * @param keywords null terminated keywords, they are not needed after the call
+ * @param n number of keywords
+ * @param case_insensitive nonzero if upper and lower case letters should not be differentiated
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int ac_build(ac_automaton *ac, char *const *keywords, size_t n, int case_insensitive);
+
+/**
+ * @brief Frees the tables of an automaton.
+ * @param ac automaton built with ac_build
+ */
+void ac_free(ac_automaton *ac);
+
+/**
+ * @brief Searches the keywords in a buffer.
+ * @details Returns the keyword occurrence that ends first, if several keywords end there the longest one is reported.
+ *          The buffer does not have to be null terminated.
+ * @param ac prepared automaton
+ * @param haystack buffer to search in
+ * @param len length of the buffer in bytes
+ * @param match_len set to the length of the found keyword
+ * @return pointer to the start of the occurrence, NULL if there is none
+ */
+const char *ac_find(const ac_automaton *ac, const char *haystack, size_t len, size_t *match_len);
+
+/**
+ * @brief Function type of the test that an occurrence has to pass for ac_find_accepted.
+ * @param ctx context pointer given to ac_find_accepted
+ * @param start start of the occurrence
+ * @param len length of the occurrence
+ * @return nonzero if the occurrence is accepted
+ */
+typedef int (*ac_accept)(const void *ctx, const char *start, size_t len);
+
+/**
+ * @brief Searches the first keyword occurrence in a buffer that passes a test.
+ * @details Every occurrence is tested in the order of its end, of the keywords that end in the same place the longest first.
+ *          The scan goes on after a rejected occurrence, so occurrences that start before it are not missed.
+ * @param ac prepared automaton
+ * @param haystack buffer to search in
+ * @param len length of the buffer in bytes
+ * @param accept test of an occurrence
+ * @param ctx context pointer given to accept
+ * @param match_len set to the length of the found keyword
+ * @return pointer to the start of the occurrence, NULL if there is none
+ */
+const char *ac_find_accepted(const ac_automaton *ac, const char *haystack, size_t len, ac_accept accept, const void *ctx, size_t *match_len);
+
+#endif
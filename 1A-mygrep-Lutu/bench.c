@@ -0,0 +1,265 @@
+/**
+ * @file bench.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Benchmark of mygrep on a generated log file.
+ * @details Generates a synthetic log corpus (size, average line length and share of matching lines can be chosen, the content only
+ *          depends on these values) and runs mygrep on it in several search modes. Every mode is run a few times, the fastest
+ *          run is reported. The result is one tab separated line per mode on stdout:
+ *          mode, bytes, lines, seconds, GB/s, lines/s and the peak resident set size of mygrep in KiB.
+ *          Used by "make bench".
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define BENCH_MAX_ARGS 16 /**< Largest number of arguments of a mygrep call. */
+
+static char *prog_name; /**< char pointer to the name of the program (argv[0]). Used for error messages */
+
+/**
+ * @brief One search mode.
+ */
+typedef struct {
+    const char *name; /**< Name in the report. */
+    const char *args[BENCH_MAX_ARGS]; /**< Arguments after the program name, the corpus is appended unless from_stdin is set. */
+    int from_stdin; /**< Nonzero if the corpus is given on stdin. */
+} bench_mode;
+
+/** The keyword occurs in the matching lines only, the other keywords of "multi" never occur. */
+static const bench_mode modes[] = {
+    { "fixed", { "needle" }, 0 },
+    { "icase", { "-i", "NEEDLE" }, 0 },
+    { "multi", { "-e", "needle", "-e", "qzxjv", "-e", "wvkpq" }, 0 },
+    { "regex", { "-E", "need(le|ful)" }, 0 },
+    { "count", { "-c", "needle" }, 0 },
+    { "stdin", { "needle" }, 1 },
+};
+
+/** Words of the generated lines, none of them contains a keyword of the modes. */
+static const char *const words[] = {
+    "request", "served", "client", "latency", "session", "user", "GET", "POST", "/api/v1/orders", "/index.html",
+    "status=200", "status=404", "status=500", "retry", "timeout", "cache", "miss", "hit", "worker", "queue",
+    "connection", "closed", "opened", "bytes", "upstream", "backend", "checksum", "token", "expired", "refresh",
+};
+
+static const char *const levels[] = { "INFO", "DEBUG", "WARN", "ERROR" };
+
+/**
+ * @brief prints usage to stdout
+ */
+static void usage(void){
+    printf("Usage: %s [-s size_mib] [-l line_length] [-d density] [-r runs] mygrep corpus\n", prog_name);
+    printf("[-s size_mib] size of the generated corpus in MiB (default 256).\n");
+    printf("[-l line_length] average length of a line in bytes (default 120).\n");
+    printf("[-d density] share of the lines that match, between 0 and 1 (default 0.001).\n");
+    printf("[-r runs] number of runs per mode, the fastest is reported (default 3).\n");
+    printf("mygrep: path of the program to measure.\n");
+    printf("corpus: file the corpus is written to, it is kept after the run.\n");
+}
+
+/**
+ * @brief xorshift random number generator, the same seed gives the same corpus
+ * @param state state of the generator
+ * @return next random number
+ */
+static uint64_t next_random(uint64_t *state){
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/**
+ * @brief writes the corpus
+ * @param filename name of the corpus file
+ * @param size size in bytes, the last line may end a bit later
+ * @param line_len average line length in bytes
+ * @param density share of matching lines
+ * @param lines set to the number of lines
+ * @param bytes set to the size of the corpus, the last line ends after size
+ * @return 0 on success, -1 on error
+ */
+static int generate(const char *filename, size_t size, size_t line_len, double density, size_t *lines, size_t *bytes){
+    FILE *out = fopen(filename, "w");
+    if(out == NULL) return -1;
+
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    uint64_t threshold = (uint64_t) (density * 18446744073709551615.0); // lines with a random number below match
+    size_t nwords = sizeof(words) / sizeof(words[0]);
+    char line[4096];
+    size_t written = 0;
+    *lines = 0;
+    while(written < size){
+        size_t target = line_len / 2 + next_random(&state) % (line_len + 1); // between half and one and a half times the average
+        if(target > sizeof(line) - 64) target = sizeof(line) - 64;
+        uint64_t t = *lines;
+        int len = sprintf(line, "2023-10-21T%02u:%02u:%02u.%03u %s ", (unsigned) (t / 3600000 % 24), (unsigned) (t / 60000 % 60),
+                          (unsigned) (t / 1000 % 60), (unsigned) (t % 1000), levels[next_random(&state) % 4]);
+        size_t needle_at = (next_random(&state) < threshold) ? next_random(&state) % (target + 1) : SIZE_MAX;
+        while((size_t) len < target){
+            if((size_t) len >= needle_at){
+                len += sprintf(line + len, "needle ");
+                needle_at = SIZE_MAX;
+            }
+            len += sprintf(line + len, "%s ", words[next_random(&state) % nwords]);
+        }
+        if(needle_at != SIZE_MAX) len += sprintf(line + len, "needle ");
+        line[len - 1] = '\n';
+        if(fwrite(line, 1, len, out) != (size_t) len){
+            fclose(out);
+            return -1;
+        }
+        written += len;
+        (*lines)++;
+    }
+    *bytes = written;
+    return fclose(out) == EOF ? -1 : 0;
+}
+
+/**
+ * @brief runs mygrep once with its output going to /dev/null
+ * @param mygrep path of the program
+ * @param mode search mode
+ * @param corpus name of the corpus file
+ * @param seconds set to the wall clock time of the run
+ * @param max_rss set to the peak resident set size in KiB
+ * @return 0 on success, -1 if the program could not be run or failed
+ */
+static int run(const char *mygrep, const bench_mode *mode, const char *corpus, double *seconds, long *max_rss){
+    char *argv[BENCH_MAX_ARGS + 2];
+    int argc = 0;
+    argv[argc++] = (char *) mygrep;
+    for(int i = 0; mode->args[i] != NULL; i++) argv[argc++] = (char *) mode->args[i];
+    if(!mode->from_stdin) argv[argc++] = (char *) corpus;
+    argv[argc] = NULL;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if(pid == -1) return -1;
+    if(pid == 0){
+        int null = open("/dev/null", O_WRONLY);
+        int in = mode->from_stdin ? open(corpus, O_RDONLY) : STDIN_FILENO;
+        if(null == -1 || in == -1 || dup2(null, STDOUT_FILENO) == -1 || dup2(in, STDIN_FILENO) == -1) _exit(127);
+        execv(mygrep, argv);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    while(wait4(pid, &status, 0, &usage) == -1){
+        if(errno != EINTR) return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    *max_rss = usage.ru_maxrss;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+/**
+ * @brief parses a positive number argument
+ * @param str argument
+ * @param value set to the number
+ * @return 0 on success, -1 if str is not a positive number
+ */
+static int parse_size(const char *str, size_t *value){
+    char *end;
+    errno = 0;
+    unsigned long long n = strtoull(str, &end, 10);
+    if(errno != 0 || end == str || *end != '\0' || n == 0) return -1;
+    *value = (size_t) n;
+    return 0;
+}
+
+/**
+ * @brief main function: generates the corpus and measures every mode
+ * @param argc arguments count
+ * @param argv arguments
+ * @return EXIT_SUCCESS if every run succeeded
+ */
+int main(int argc, char *argv[]){
+    size_t size_mib = 256, line_len = 120, runs = 3;
+    double density = 0.001;
+    prog_name = argv[0];
+
+    int opt;
+    while((opt = getopt(argc, argv, "s:l:d:r:")) != -1){
+        int bad = 0;
+        char *end;
+        switch(opt){
+            case 's':
+                bad = parse_size(optarg, &size_mib);
+                break;
+            case 'l':
+                bad = parse_size(optarg, &line_len) || line_len < 32;
+                break;
+            case 'd':
+                errno = 0;
+                density = strtod(optarg, &end);
+                bad = errno != 0 || end == optarg || *end != '\0' || density < 0 || density > 1;
+                break;
+            case 'r':
+                bad = parse_size(optarg, &runs);
+                break;
+            default:
+                usage();
+                return EXIT_FAILURE;
+        }
+        if(bad){
+            fprintf(stderr, "[%s] Error: [%s] Invalid value for -%c\n", prog_name, optarg, opt);
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if(argc - optind != 2){
+        usage();
+        return EXIT_FAILURE;
+    }
+    const char *mygrep = argv[optind];
+    const char *corpus = argv[optind + 1];
+
+    size_t bytes, lines;
+    fprintf(stderr, "generating %zu MiB corpus in %s\n", size_mib, corpus);
+    if(generate(corpus, size_mib << 20, line_len, density, &lines, &bytes) == -1){
+        fprintf(stderr, "[%s] Error: [%s] Failed to write corpus: %s\n", prog_name, corpus, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int ret = EXIT_SUCCESS;
+    printf("mode\tbytes\tlines\tseconds\tgb_per_s\tlines_per_s\tmax_rss_kib\n");
+    for(size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++){
+        double best = 0;
+        long rss = 0;
+        int ok = 1;
+        for(size_t r = 0; r < runs && ok; r++){
+            double seconds;
+            long max_rss;
+            if(run(mygrep, &modes[m], corpus, &seconds, &max_rss) == -1){
+                fprintf(stderr, "[%s] Error: [%s] Run of mode %s failed\n", prog_name, mygrep, modes[m].name);
+                ok = 0;
+                ret = EXIT_FAILURE;
+                break;
+            }
+            if(r == 0 || seconds < best) best = seconds;
+            if(max_rss > rss) rss = max_rss;
+        }
+        if(!ok) continue;
+        printf("%s\t%zu\t%zu\t%.6f\t%.3f\t%.0f\t%ld\n", modes[m].name, bytes, lines, best, bytes / best / 1e9, lines / best, rss);
+        fflush(stdout);
+    }
+    return ret;
+}
@@ -0,0 +1,471 @@
+/**
+ * @file fetch.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Opens and reads input files ahead of the search.
+ * @details File i uses slot i % FETCH_WINDOW. It is started once file i - FETCH_WINDOW was released, so the slots are
+ *          reused in order and never more than FETCH_WINDOW files (and their data) are held at the same time.
+ *          With io_uring there is no extra thread: every call of fetch_next submits the open and statx requests of the files
+ *          that became startable, collects the completions and submits a read for every small regular file. The kernel works
+ *          on them while the caller searches. Without io_uring FETCH_THREADS threads open and read the files with plain syscalls.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "fetch.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#if !defined(FETCH_NO_URING) && defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define FETCH_URING
+#include <stdint.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+/**
+ * @brief State of one file in flight.
+ */
+typedef struct {
+    fetched file; /**< What the caller gets. */
+    int ready; /**< Set when the file is opened (and read). */
+#ifdef FETCH_URING
+    int pending; /**< Number of io_uring requests in flight. */
+    int stat_ok; /**< Set if statx succeeded. */
+    struct statx stx; /**< Result of statx. */
+#endif
+} fetch_slot;
+
+#ifdef FETCH_URING
+/**
+ * @brief Submission and completion queue shared with the kernel.
+ */
+typedef struct {
+    int fd; /**< io_uring file descriptor. */
+    void *sq_map; /**< Mapping of the submission ring. */
+    size_t sq_map_size; /**< Size of sq_map. */
+    void *cq_map; /**< Mapping of the completion ring, the same as sq_map with IORING_FEAT_SINGLE_MMAP. */
+    size_t cq_map_size; /**< Size of cq_map. */
+    struct io_uring_sqe *sqes; /**< Submission queue entries. */
+    size_t sqes_size; /**< Size of the mapping of sqes. */
+    unsigned *sq_tail; /**< Tail of the submission ring, written by us. */
+    unsigned *sq_mask; /**< Mask for sq indices. */
+    unsigned *sq_array; /**< Indices of the submitted sqes. */
+    unsigned *cq_head; /**< Head of the completion ring, written by us. */
+    unsigned *cq_tail; /**< Tail of the completion ring, written by the kernel. */
+    unsigned *cq_mask; /**< Mask for cq indices. */
+    struct io_uring_cqe *cqes; /**< Completion queue entries. */
+    unsigned to_submit; /**< Number of sqes not given to the kernel yet. */
+    unsigned inflight; /**< Number of requests submitted but not completed. */
+} uring;
+
+/** Operations, stored in the lowest two bits of user_data. */
+enum { OP_OPEN, OP_STAT, OP_READ };
+#endif
+
+/**
+ * @brief State of the fetcher.
+ */
+struct fetcher {
+    char *const *files; /**< Names of the files. */
+    int n; /**< Number of files. */
+    int started; /**< Number of files started. */
+    int taken; /**< Number of files returned by fetch_next. */
+    int released; /**< Number of files released by fetch_done. */
+    fetch_slot slots[FETCH_WINDOW]; /**< File i uses slot i % FETCH_WINDOW. */
+    int use_uring; /**< Nonzero if ring is used, else the threads. */
+#ifdef FETCH_URING
+    uring ring; /**< io_uring instance. */
+#endif
+    pthread_t threads[FETCH_THREADS]; /**< Threads if io_uring is not used. */
+    int nthreads; /**< Number of threads started. */
+    pthread_mutex_t mutex; /**< Protects started, released, ready and stop for the threads. */
+    pthread_cond_t cond; /**< Signaled when a file is ready or released. */
+    int stop; /**< Set by fetch_stop. */
+};
+
+/**
+ * @brief reads a small regular file completely, one byte more than its size is requested to notice a file that grows
+ * @param file opened file, data and size are set if the whole file could be read
+ * @param size size of the file from fstat
+ */
+static void read_small(fetched *file, size_t size){
+    char *data = malloc(size + 1);
+    if(data == NULL) return;
+    size_t got = 0;
+    while(got < size + 1){
+        ssize_t r = pread(file->fd, data + got, size + 1 - got, got);
+        if(r == -1 && errno == EINTR) continue;
+        if(r <= 0) break;
+        got += r;
+    }
+    if(got != size){
+        free(data); // changed while reading or failed, the caller reads it through fd
+        return;
+    }
+    file->data = data;
+    file->size = size;
+}
+
+/**
+ * @brief opens a file and reads it if it is small (thread variant)
+ * @param name name of the file
+ * @param file set to the result
+ */
+static void load_file(const char *name, fetched *file){
+    file->data = NULL;
+    file->size = 0;
+    file->error = 0;
+    file->fd = open(name, O_RDONLY);
+    if(file->fd == -1){
+        file->error = errno;
+        return;
+    }
+    struct stat st;
+    if(fstat(file->fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0 || st.st_size > FETCH_SMALL) return;
+    read_small(file, st.st_size);
+}
+
+/**
+ * @brief fetch thread: opens and reads the next file that may be started
+ * @param arg fetcher
+ * @return NULL
+ */
+static void *fetch_thread(void *arg){
+    fetcher *f = arg;
+    pthread_mutex_lock(&f->mutex);
+    for(;;){
+        while(!f->stop && f->started < f->n && f->started >= f->released + FETCH_WINDOW) pthread_cond_wait(&f->cond, &f->mutex);
+        if(f->stop || f->started >= f->n) break;
+        int i = f->started++;
+        pthread_mutex_unlock(&f->mutex);
+
+        fetch_slot *slot = &f->slots[i % FETCH_WINDOW];
+        load_file(f->files[i], &slot->file);
+
+        pthread_mutex_lock(&f->mutex);
+        slot->ready = 1;
+        pthread_cond_broadcast(&f->cond);
+    }
+    pthread_mutex_unlock(&f->mutex);
+    return NULL;
+}
+
+#ifdef FETCH_URING
+/**
+ * @brief sets up an io_uring instance and checks that the kernel supports the needed operations
+ * @param r ring to set up
+ * @return 0 on success, -1 if io_uring can not be used
+ */
+static int uring_init(uring *r){
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+    r->fd = (int) syscall(__NR_io_uring_setup, 2 * FETCH_WINDOW, &p); // open + statx of every file in the window
+    if(r->fd < 0) return -1;
+
+    size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_size);
+    int supported = probe != NULL && syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PROBE, probe, 256) == 0
+                    && probe->last_op >= IORING_OP_READ && probe->last_op >= IORING_OP_OPENAT && probe->last_op >= IORING_OP_STATX
+                    && (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED)
+                    && (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED)
+                    && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    if(!supported){
+        close(r->fd);
+        return -1;
+    }
+
+    r->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if(p.features & IORING_FEAT_SINGLE_MMAP){
+        if(r->cq_map_size > r->sq_map_size) r->sq_map_size = r->cq_map_size;
+        r->cq_map_size = r->sq_map_size;
+    }
+    r->sq_map = mmap(NULL, r->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if(r->sq_map == MAP_FAILED){
+        close(r->fd);
+        return -1;
+    }
+    r->cq_map = r->sq_map;
+    if(!(p.features & IORING_FEAT_SINGLE_MMAP)){
+        r->cq_map = mmap(NULL, r->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if(r->cq_map == MAP_FAILED){
+            munmap(r->sq_map, r->sq_map_size);
+            close(r->fd);
+            return -1;
+        }
+    }
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if(r->sqes == MAP_FAILED){
+        if(r->cq_map != r->sq_map) munmap(r->cq_map, r->cq_map_size);
+        munmap(r->sq_map, r->sq_map_size);
+        close(r->fd);
+        return -1;
+    }
+
+    char *sq = r->sq_map, *cq = r->cq_map;
+    r->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *) (sq + p.sq_off.array);
+    r->cq_head = (unsigned *) (cq + p.cq_off.head);
+    r->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+    return 0;
+}
+
+/**
+ * @brief removes an io_uring instance, no request may be in flight
+ * @param r ring
+ */
+static void uring_free(uring *r){
+    munmap(r->sqes, r->sqes_size);
+    if(r->cq_map != r->sq_map) munmap(r->cq_map, r->cq_map_size);
+    munmap(r->sq_map, r->sq_map_size);
+    close(r->fd);
+}
+
+/**
+ * @brief appends an empty request to the submission ring, there is always room because of the window
+ * @param r ring
+ * @param slot slot number of the file
+ * @param op operation, stored together with the slot in user_data
+ * @return sqe to fill in
+ */
+static struct io_uring_sqe *uring_sqe(uring *r, int slot, int op){
+    unsigned tail = *r->sq_tail;
+    unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (uint64_t) slot << 2 | op;
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->to_submit++;
+    r->inflight++;
+    return sqe;
+}
+
+/**
+ * @brief submits the queued requests and waits for completions
+ * @param r ring
+ * @param wait number of completions to wait for
+ */
+static void uring_enter(uring *r, unsigned wait){
+    stats *st = stats_current(); // made by the searching thread, counted for its input (--stats)
+    for(;;){
+        long n = syscall(__NR_io_uring_enter, r->fd, r->to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if(st != NULL) st->syscalls++;
+        if(n >= 0){
+            r->to_submit -= (unsigned) n;
+            return;
+        }
+        if(errno == EINTR) continue;
+        if(errno == EAGAIN || errno == EBUSY) return; // the kernel is short of resources, completions are collected first
+        fprintf(stderr, "Error: io_uring_enter failed: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief submits open and statx of file i
+ * @param f fetcher
+ * @param i index of the file
+ */
+static void uring_start(fetcher *f, int i){
+    int s = i % FETCH_WINDOW;
+    fetch_slot *slot = &f->slots[s];
+    memset(slot, 0, sizeof(*slot));
+    slot->file.fd = -1;
+    slot->pending = 2;
+
+    struct io_uring_sqe *sqe = uring_sqe(&f->ring, s, OP_OPEN);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t) (uintptr_t) f->files[i];
+    sqe->open_flags = O_RDONLY;
+
+    sqe = uring_sqe(&f->ring, s, OP_STAT);
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t) (uintptr_t) f->files[i];
+    sqe->len = STATX_TYPE | STATX_SIZE;
+    sqe->off = (uint64_t) (uintptr_t) &slot->stx;
+}
+
+/**
+ * @brief handles one completion, submits the read of a small regular file once it is opened
+ * @param f fetcher
+ * @param cqe completion
+ */
+static void uring_complete(fetcher *f, const struct io_uring_cqe *cqe){
+    int s = (int) (cqe->user_data >> 2);
+    int op = (int) (cqe->user_data & 3);
+    fetch_slot *slot = &f->slots[s];
+    fetched *file = &slot->file;
+    f->ring.inflight--;
+    slot->pending--;
+
+    if(op == OP_READ){
+        if(cqe->res < 0 || (size_t) cqe->res != file->size){
+            free(file->data); // changed while reading or failed, the caller reads it through fd
+            file->data = NULL;
+            file->size = 0;
+        }
+        slot->ready = 1;
+        return;
+    }
+
+    if(op == OP_OPEN){
+        if(cqe->res < 0) file->error = -cqe->res;
+        else file->fd = cqe->res;
+    } else {
+        slot->stat_ok = (cqe->res == 0);
+    }
+    if(slot->pending > 0) return;
+
+    size_t size = slot->stx.stx_size;
+    if(file->fd >= 0 && slot->stat_ok && S_ISREG(slot->stx.stx_mode) && size > 0 && size <= FETCH_SMALL){
+        file->data = malloc(size + 1);
+        if(file->data != NULL){
+            file->size = size;
+            struct io_uring_sqe *sqe = uring_sqe(&f->ring, s, OP_READ);
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = file->fd;
+            sqe->addr = (uint64_t) (uintptr_t) file->data;
+            sqe->len = (unsigned) size + 1; // one byte more to notice a file that grows
+            sqe->off = 0;
+            slot->pending = 1;
+            return;
+        }
+    }
+    slot->ready = 1;
+}
+
+/**
+ * @brief collects all available completions
+ * @param f fetcher
+ */
+static void uring_reap(fetcher *f){
+    uring *r = &f->ring;
+    unsigned head = *r->cq_head;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    while(head != tail){
+        uring_complete(f, &r->cqes[head & *r->cq_mask]);
+        head++;
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+        tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    }
+}
+#endif
+
+fetcher *fetch_start(char *const *files, int n){
+    fetcher *f = calloc(1, sizeof(fetcher));
+    if(f == NULL) return NULL;
+    f->files = files;
+    f->n = n;
+
+#ifdef FETCH_URING
+    if(uring_init(&f->ring) == 0){
+        f->use_uring = 1;
+        return f;
+    }
+#endif
+
+    pthread_mutex_init(&f->mutex, NULL);
+    pthread_cond_init(&f->cond, NULL);
+    for(; f->nthreads < FETCH_THREADS && f->nthreads < n; f->nthreads++){
+        if(pthread_create(&f->threads[f->nthreads], NULL, fetch_thread, f) != 0) break;
+    }
+    if(f->nthreads == 0){
+        pthread_cond_destroy(&f->cond);
+        pthread_mutex_destroy(&f->mutex);
+        free(f);
+        return NULL;
+    }
+    return f;
+}
+
+fetched *fetch_next(fetcher *f){
+    int i = f->taken++;
+    fetch_slot *slot = &f->slots[i % FETCH_WINDOW];
+
+#ifdef FETCH_URING
+    if(f->use_uring){
+        while(f->started < f->n && f->started < f->released + FETCH_WINDOW) uring_start(f, f->started++);
+        uring_enter(&f->ring, 0);
+        uring_reap(f);
+        while(!slot->ready){
+            uring_enter(&f->ring, 1);
+            uring_reap(f);
+        }
+        if(f->ring.to_submit > 0) uring_enter(&f->ring, 0); // reads of later files run while the caller searches
+        return &slot->file;
+    }
+#endif
+
+    pthread_mutex_lock(&f->mutex);
+    while(!slot->ready) pthread_cond_wait(&f->cond, &f->mutex);
+    pthread_mutex_unlock(&f->mutex);
+    return &slot->file;
+}
+
+/**
+ * @brief closes the descriptor and frees the data of a file
+ * @param file file
+ */
+static void release_file(fetched *file){
+    if(file->fd >= 0) close(file->fd);
+    free(file->data);
+    file->fd = -1;
+    file->data = NULL;
+}
+
+void fetch_done(fetcher *f, fetched *file){
+    release_file(file);
+    if(f->use_uring){
+        f->slots[f->released % FETCH_WINDOW].ready = 0;
+        f->released++;
+        return;
+    }
+    pthread_mutex_lock(&f->mutex);
+    f->slots[f->released % FETCH_WINDOW].ready = 0;
+    f->released++;
+    pthread_cond_broadcast(&f->cond);
+    pthread_mutex_unlock(&f->mutex);
+}
+
+void fetch_stop(fetcher *f){
+#ifdef FETCH_URING
+    if(f->use_uring){
+        while(f->ring.inflight > 0){
+            uring_enter(&f->ring, 1);
+            uring_reap(f);
+        }
+        uring_free(&f->ring);
+    }
+#endif
+    if(!f->use_uring){
+        pthread_mutex_lock(&f->mutex);
+        f->stop = 1;
+        pthread_cond_broadcast(&f->cond);
+        pthread_mutex_unlock(&f->mutex);
+        for(int i = 0; i < f->nthreads; i++) pthread_join(f->threads[i], NULL);
+        pthread_cond_destroy(&f->cond);
+        pthread_mutex_destroy(&f->mutex);
+    }
+    for(int i = f->released; i < f->started; i++) release_file(&f->slots[i % FETCH_WINDOW].file); // fetched but never taken
+    free(f);
+}
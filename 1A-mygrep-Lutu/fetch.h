@@ -0,0 +1,62 @@
+/**
+ * @file fetch.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Opens and reads input files ahead of the search.
+ * @details Up to FETCH_WINDOW files after the one that is searched are opened, and small regular files are read completely into memory
+ *          while the search of earlier files goes on. The caller gets the files in the order of the list.
+ *          On Linux the requests are given to the kernel through io_uring, so many of them are in flight without a thread each.
+ *          Where io_uring is not available (older kernel, not allowed, -DFETCH_NO_URING) a few threads do the same with open and pread.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef FETCH_H
+#define FETCH_H
+
+#include <stddef.h>
+
+#define FETCH_WINDOW 64 /**< Number of files that are opened and read ahead of the caller. */
+#define FETCH_SMALL (128 << 10) /**< Regular files up to this size are read into memory (128 KiB). */
+#define FETCH_THREADS 4 /**< Number of threads if io_uring is not available. */
+
+typedef struct fetcher fetcher;
+
+/**
+ * @brief An opened input file.
+ */
+typedef struct {
+    int fd; /**< File descriptor, -1 if the file could not be opened. Set to -1 by the caller if it takes over the descriptor. */
+    int error; /**< errno of the failed open. */
+    char *data; /**< Complete content of a small regular file, else NULL (the file is then read through fd). */
+    size_t size; /**< Size of data in bytes. */
+} fetched;
+
+/**
+ * @brief Starts opening and reading the files.
+ * @param files names of the files, must stay valid until fetch_stop
+ * @param n number of files
+ * @return fetcher, NULL if memory or the threads could not be allocated
+ */
+fetcher *fetch_start(char *const *files, int n);
+
+/**
+ * @brief Waits for the next file of the list.
+ * @param f fetcher
+ * @return the file, valid until fetch_done. Must not be called more often than there are files.
+ */
+fetched *fetch_next(fetcher *f);
+
+/**
+ * @brief Releases a file returned by fetch_next. The descriptor is closed if the caller did not take it over.
+ * @param f fetcher
+ * @param file file from fetch_next
+ */
+void fetch_done(fetcher *f, fetched *file);
+
+/**
+ * @brief Waits for all requests in flight and frees the fetcher.
+ * @param f fetcher from fetch_start
+ */
+void fetch_stop(fetcher *f);
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file gzin.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Reads gzip compressed input files.
+ * @details The blocks form a ring. The decompression thread fills block produced % GZIN_SLOTS, the reader empties
+ *          block consumed % GZIN_SLOTS. A block belongs to the thread while it is filled and to the reader until it is empty,
+ *          so the data is copied without holding the mutex.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "gzin.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#define GZIN_READ (64 << 10) /**< Size of the buffer for compressed data (64 KiB). */
+
+/**
+ * @brief State shared between the decompression thread and the reader.
+ */
+struct gzin_reader {
+    int fd; /**< Compressed file. */
+    pthread_t thread; /**< Decompression thread. */
+    pthread_mutex_t mutex; /**< Protects produced, consumed, done, error and stop. */
+    pthread_cond_t cond; /**< Signaled when a block is filled or emptied. */
+    char *data; /**< GZIN_SLOTS blocks of GZIN_BLOCK bytes. */
+    size_t fill[GZIN_SLOTS]; /**< Number of bytes in every block. */
+    unsigned long produced; /**< Number of blocks filled so far. */
+    unsigned long consumed; /**< Number of blocks emptied so far. */
+    size_t pos; /**< Read position in the current block of the reader. */
+    int done; /**< Set when the thread fills no more blocks. */
+    int error; /**< Set if the file could not be read or is not valid gzip data. */
+    int stop; /**< Set by gzin_close, the thread stops as soon as possible. */
+};
+
+int gzin_detect(int fd){
+    unsigned char magic[2];
+    return pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+/**
+ * @brief decompression thread: fills the blocks until the end of the file, an error or gzin_close
+ * @param arg gzin_reader
+ * @return NULL
+ */
+static void *inflate_thread(void *arg){
+    gzin_reader *r = arg;
+    unsigned char in[GZIN_READ];
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    int member_done = 0; // set between two gzip members, the file may end there
+
+    int status = 0; // 0: more data follows, 1: end of the file, -1: error
+    if(inflateInit2(&zs, 15 + 16) != Z_OK) status = -1;
+
+    while(status == 0){
+        pthread_mutex_lock(&r->mutex);
+        while(r->produced - r->consumed == GZIN_SLOTS && !r->stop) pthread_cond_wait(&r->cond, &r->mutex);
+        int stop = r->stop;
+        pthread_mutex_unlock(&r->mutex);
+        if(stop) break;
+
+        int slot = (int) (r->produced % GZIN_SLOTS);
+        zs.next_out = (unsigned char *) r->data + (size_t) slot * GZIN_BLOCK;
+        zs.avail_out = GZIN_BLOCK;
+        while(status == 0 && zs.avail_out > 0){
+            if(zs.avail_in == 0){
+                ssize_t n = read(r->fd, in, sizeof(in));
+                if(n == -1 && errno == EINTR) continue;
+                if(n <= 0){
+                    status = (n == 0 && member_done) ? 1 : -1; // a file that ends inside a member is truncated
+                    break;
+                }
+                zs.next_in = in;
+                zs.avail_in = (uInt) n;
+            }
+            member_done = 0;
+            int z = inflate(&zs, Z_NO_FLUSH);
+            if(z == Z_STREAM_END){
+                member_done = 1;
+                if(inflateReset(&zs) != Z_OK) status = -1; // another member may follow
+            } else if(z != Z_OK && z != Z_BUF_ERROR){
+                status = -1;
+            }
+        }
+
+        pthread_mutex_lock(&r->mutex);
+        r->fill[slot] = GZIN_BLOCK - zs.avail_out;
+        if(r->fill[slot] > 0) r->produced++; // an empty block would look like the end of the data to the reader
+        if(status != 0){
+            r->done = 1;
+            r->error = (status == -1);
+        }
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->mutex);
+    }
+
+    inflateEnd(&zs);
+    pthread_mutex_lock(&r->mutex);
+    r->done = 1;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->mutex);
+    return NULL;
+}
+
+gzin_reader *gzin_open(int fd){
+    gzin_reader *r = calloc(1, sizeof(gzin_reader));
+    if(r == NULL) return NULL;
+    r->fd = fd;
+    r->data = malloc((size_t) GZIN_SLOTS * GZIN_BLOCK);
+    if(r->data == NULL){
+        free(r);
+        return NULL;
+    }
+    pthread_mutex_init(&r->mutex, NULL);
+    pthread_cond_init(&r->cond, NULL);
+    if(pthread_create(&r->thread, NULL, inflate_thread, r) != 0){
+        pthread_cond_destroy(&r->cond);
+        pthread_mutex_destroy(&r->mutex);
+        free(r->data);
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+ssize_t gzin_read(gzin_reader *r, char *buf, size_t len){
+    pthread_mutex_lock(&r->mutex);
+    while(r->consumed == r->produced && !r->done) pthread_cond_wait(&r->cond, &r->mutex);
+    if(r->consumed == r->produced){
+        int error = r->error;
+        pthread_mutex_unlock(&r->mutex);
+        return error ? -1 : 0;
+    }
+    int slot = (int) (r->consumed % GZIN_SLOTS);
+    pthread_mutex_unlock(&r->mutex);
+
+    size_t n = r->fill[slot] - r->pos;
+    if(n > len) n = len;
+    memcpy(buf, r->data + (size_t) slot * GZIN_BLOCK + r->pos, n);
+    r->pos += n;
+    if(r->pos == r->fill[slot]){
+        pthread_mutex_lock(&r->mutex);
+        r->consumed++;
+        r->pos = 0;
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->mutex);
+    }
+    return (ssize_t) n;
+}
+
+void gzin_close(gzin_reader *r){
+    pthread_mutex_lock(&r->mutex);
+    r->stop = 1;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->mutex);
+    pthread_join(r->thread, NULL);
+
+    pthread_cond_destroy(&r->cond);
+    pthread_mutex_destroy(&r->mutex);
+    free(r->data);
+    free(r);
+}
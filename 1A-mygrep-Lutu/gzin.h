@@ -0,0 +1,51 @@
+/**
+ * @file gzin.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Reads gzip compressed input files.
+ * @details The file is decompressed with zlib by a separate thread into a few fixed blocks, the caller reads the
+ *          decompressed data from these blocks. Decompression of the next blocks overlaps with searching the current one.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef GZIN_H
+#define GZIN_H
+
+#include <sys/types.h>
+
+#define GZIN_BLOCK (256 << 10) /**< Size of one block of decompressed data (256 KiB). */
+#define GZIN_SLOTS 4 /**< Number of blocks the decompression thread may fill ahead of the reader. */
+
+typedef struct gzin_reader gzin_reader;
+
+/**
+ * @brief Tests if a file starts with the gzip magic bytes. The file position is not changed.
+ * @param fd file descriptor of a regular file
+ * @return 1 if the file is gzip compressed, else 0
+ */
+int gzin_detect(int fd);
+
+/**
+ * @brief Starts decompressing a file.
+ * @details The file is read from its current position. Several concatenated gzip members are decompressed one after another.
+ * @param fd file descriptor of the compressed file, not closed by gzin_close
+ * @return reader, NULL if memory or the thread could not be allocated
+ */
+gzin_reader *gzin_open(int fd);
+
+/**
+ * @brief Reads decompressed data, waits until the decompression thread has some.
+ * @param r reader
+ * @param buf buffer to read into
+ * @param len size of buf in bytes
+ * @return number of bytes read, 0 at the end of the data, -1 if the file could not be read or is not valid gzip data
+ */
+ssize_t gzin_read(gzin_reader *r, char *buf, size_t len);
+
+/**
+ * @brief Stops the decompression thread and frees the reader.
+ * @param r reader from gzin_open
+ */
+void gzin_close(gzin_reader *r);
+
+#endif
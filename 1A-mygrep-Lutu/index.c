@@ -0,0 +1,345 @@
+/**
+ * @file index.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Trigram index of a file, stored next to it as a sidecar file.
+ * @details The index is built in two passes over the file. The first pass counts in how many blocks every trigram occurs,
+ *          the second pass fills the posting lists. A trigram belongs to the block in which its first byte is.
+ *          The index file is written under a temporary name and renamed, so a reader never sees half of it.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define IDX_TRIGRAMS (1u << 24) /**< Number of possible trigrams. */
+
+/**
+ * @brief folds an ascii upper case letter to lower case, every other byte stays the same
+ * @param c byte
+ * @return folded byte
+ */
+static uint32_t fold(unsigned char c){
+    return (c >= 'A' && c <= 'Z') ? (c | 0x20) : c;
+}
+
+/**
+ * @brief returns the folded trigram that starts at p
+ * @param p start of three bytes
+ * @return trigram, first byte in bits 16-23
+ */
+static uint32_t trigram_at(const unsigned char *p){
+    return fold(p[0]) << 16 | fold(p[1]) << 8 | fold(p[2]);
+}
+
+/**
+ * @brief calls fn for every distinct trigram of a block that contains no newline
+ * @param map start of the file image
+ * @param size size of the file image
+ * @param block block number
+ * @param seen bitmap of all trigrams, all zero before and after the call
+ * @param list buffer of IDX_BLOCK entries
+ * @param fn called with the trigram, the block and ctx
+ * @param ctx passed to fn
+ */
+static void block_trigrams(const unsigned char *map, size_t size, uint32_t block, uint8_t *seen, uint32_t *list,
+                           void (*fn)(uint32_t trigram, uint32_t block, void *ctx), void *ctx){
+    size_t from = (size_t) block * IDX_BLOCK;
+    size_t to = from + IDX_BLOCK;
+    if(to > size - 2) to = size - 2; // the last trigram starts two bytes before the end
+    size_t n = 0;
+    for(size_t p = from; p < to; p++){
+        if(map[p] == '\n' || map[p + 1] == '\n' || map[p + 2] == '\n') continue; // a match never contains a newline
+        uint32_t t = trigram_at(map + p);
+        if(seen[t >> 3] & (1u << (t & 7))) continue;
+        seen[t >> 3] |= 1u << (t & 7);
+        list[n++] = t;
+        fn(t, block, ctx);
+    }
+    for(size_t i = 0; i < n; i++) seen[list[i] >> 3] = 0;
+}
+
+/**
+ * @brief Data of the two passes of idx_build.
+ */
+typedef struct {
+    uint32_t *slot; /**< pass 1: number of blocks of a trigram, pass 2: index of its entry */
+    idx_entry *entries; /**< entries, count is the fill level during pass 2 */
+    uint32_t *postings; /**< block numbers */
+} build_state;
+
+/**
+ * @brief pass 1: counts a trigram of a block
+ * @param trigram trigram
+ * @param block block number
+ * @param ctx build_state
+ */
+static void count_trigram(uint32_t trigram, uint32_t block, void *ctx){
+    build_state *b = ctx;
+    (void) block;
+    b->slot[trigram]++;
+}
+
+/**
+ * @brief pass 2: appends a block to the posting list of a trigram
+ * @param trigram trigram
+ * @param block block number
+ * @param ctx build_state
+ */
+static void add_posting(uint32_t trigram, uint32_t block, void *ctx){
+    build_state *b = ctx;
+    idx_entry *e = &b->entries[b->slot[trigram]];
+    b->postings[e->offset + e->count++] = block;
+}
+
+/**
+ * @brief writes a whole buffer
+ * @param fd file descriptor
+ * @param buf data
+ * @param len length in bytes
+ * @return 0 on success, -1 on error
+ */
+static int write_all(int fd, const void *buf, size_t len){
+    const char *p = buf;
+    while(len > 0){
+        ssize_t n = write(fd, p, len);
+        if(n == -1){
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief builds the index of a file image and writes it to fd
+ * @param fd index file
+ * @param map start of the file image
+ * @param st status of the file
+ * @return 0 on success, -1 on error
+ */
+static int build(int fd, const unsigned char *map, const struct stat *st){
+    size_t size = st->st_size;
+    uint32_t nblocks = (uint32_t) ((size + IDX_BLOCK - 1) / IDX_BLOCK);
+    build_state b = { NULL, NULL, NULL };
+    uint8_t *seen = calloc(IDX_TRIGRAMS / 8, 1);
+    uint32_t *list = malloc(IDX_BLOCK * sizeof(uint32_t));
+    b.slot = calloc(IDX_TRIGRAMS, sizeof(uint32_t));
+    int ret = -1;
+    if(seen == NULL || list == NULL || b.slot == NULL) goto out;
+
+    if(size >= 3){
+        for(uint32_t k = 0; k < nblocks; k++) block_trigrams(map, size, k, seen, list, count_trigram, &b);
+    }
+
+    uint32_t ntrigrams = 0;
+    uint64_t npostings = 0;
+    for(uint32_t t = 0; t < IDX_TRIGRAMS; t++){
+        if(b.slot[t] > 0){
+            ntrigrams++;
+            npostings += b.slot[t];
+        }
+    }
+    b.entries = malloc((ntrigrams ? ntrigrams : 1) * sizeof(idx_entry));
+    b.postings = malloc((npostings ? npostings : 1) * sizeof(uint32_t));
+    if(b.entries == NULL || b.postings == NULL) goto out;
+
+    uint32_t e = 0;
+    uint64_t offset = 0;
+    for(uint32_t t = 0; t < IDX_TRIGRAMS; t++){
+        if(b.slot[t] == 0) continue;
+        b.entries[e].trigram = t;
+        b.entries[e].count = 0;
+        b.entries[e].offset = offset;
+        offset += b.slot[t];
+        b.slot[t] = e++;
+    }
+    if(size >= 3){
+        for(uint32_t k = 0; k < nblocks; k++) block_trigrams(map, size, k, seen, list, add_posting, &b);
+    }
+
+    idx_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, IDX_MAGIC, 4);
+    h.block_size = IDX_BLOCK;
+    h.file_size = size;
+    h.mtime_sec = st->st_mtim.tv_sec;
+    h.mtime_nsec = st->st_mtim.tv_nsec;
+    h.ntrigrams = ntrigrams;
+    h.nblocks = nblocks;
+    h.npostings = npostings;
+    if(write_all(fd, &h, sizeof(h)) == 0 && write_all(fd, b.entries, ntrigrams * sizeof(idx_entry)) == 0
+       && write_all(fd, b.postings, npostings * sizeof(uint32_t)) == 0){
+        ret = 0;
+    }
+
+out:
+    if(ret == -1 && errno == 0) errno = ENOMEM;
+    free(seen);
+    free(list);
+    free(b.slot);
+    free(b.entries);
+    free(b.postings);
+    return ret;
+}
+
+int idx_build(const char *filename){
+    int fd = open(filename, O_RDONLY);
+    if(fd == -1) return -1;
+    struct stat st;
+    if(fstat(fd, &st) == -1){
+        close(fd);
+        return -1;
+    }
+    if(!S_ISREG(st.st_mode)){
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    const unsigned char *map = NULL;
+    if(st.st_size > 0){
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED){
+            close(fd);
+            return -1;
+        }
+        madvise((void *) map, st.st_size, MADV_SEQUENTIAL);
+    }
+
+    size_t len = strlen(filename) + strlen(IDX_SUFFIX);
+    char *name = malloc(len + 1);
+    char *tmp = malloc(len + sizeof(".tmp"));
+    int ret = -1;
+    if(name != NULL && tmp != NULL){
+        sprintf(name, "%s%s", filename, IDX_SUFFIX);
+        sprintf(tmp, "%s.tmp", name);
+        int out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if(out != -1){
+            errno = 0;
+            ret = build(out, map, &st);
+            if(close(out) == -1) ret = -1;
+            if(ret == 0 && rename(tmp, name) == -1) ret = -1;
+            if(ret == -1){
+                int saved = errno;
+                unlink(tmp);
+                errno = saved;
+            }
+        }
+    } else {
+        errno = ENOMEM;
+    }
+    free(name);
+    free(tmp);
+
+    if(map != NULL) munmap((void *) map, st.st_size);
+    close(fd);
+    return ret;
+}
+
+int idx_open(file_index *ix, const char *filename, const struct stat *st){
+    size_t len = strlen(filename);
+    char *name = malloc(len + sizeof(IDX_SUFFIX));
+    if(name == NULL) return -1;
+    sprintf(name, "%s%s", filename, IDX_SUFFIX);
+    int fd = open(name, O_RDONLY);
+    free(name);
+    if(fd == -1) return -1;
+
+    struct stat ist;
+    if(fstat(fd, &ist) == -1 || (size_t) ist.st_size < sizeof(idx_header)){
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, ist.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return -1;
+
+    const idx_header *h = map;
+    size_t expected = sizeof(idx_header) + (size_t) h->ntrigrams * sizeof(idx_entry) + (size_t) h->npostings * sizeof(uint32_t);
+    if(memcmp(h->magic, IDX_MAGIC, 4) != 0 || expected != (size_t) ist.st_size || h->block_size == 0
+       || h->file_size != (uint64_t) st->st_size || h->mtime_sec != st->st_mtim.tv_sec || h->mtime_nsec != st->st_mtim.tv_nsec
+       || h->nblocks != (h->file_size + h->block_size - 1) / h->block_size){
+        munmap(map, ist.st_size); // missing, damaged or stale: the file changed after the index was built
+        return -1;
+    }
+
+    ix->map = map;
+    ix->map_size = ist.st_size;
+    ix->header = h;
+    ix->entries = (const idx_entry *) (h + 1);
+    ix->postings = (const uint32_t *) (ix->entries + h->ntrigrams);
+    return 0;
+}
+
+void idx_close(file_index *ix){
+    munmap(ix->map, ix->map_size);
+    ix->map = NULL;
+}
+
+/**
+ * @brief finds the entry of a trigram with a binary search
+ * @param ix opened index
+ * @param t trigram
+ * @return entry, NULL if the trigram does not occur in the file
+ */
+static const idx_entry *find_entry(const file_index *ix, uint32_t t){
+    size_t lo = 0, hi = ix->header->ntrigrams;
+    while(lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        if(ix->entries[mid].trigram < t) lo = mid + 1;
+        else hi = mid;
+    }
+    if(lo < ix->header->ntrigrams && ix->entries[lo].trigram == t) return &ix->entries[lo];
+    return NULL;
+}
+
+int idx_candidates(const file_index *ix, char *const *lits, size_t nlits, unsigned char *blocks){
+    uint32_t nblocks = ix->header->nblocks;
+    for(size_t i = 0; i < nlits; i++){
+        size_t len = strlen(lits[i]);
+        if(len < 3 || len > ix->header->block_size || memchr(lits[i], '\n', len) != NULL) return -1;
+    }
+
+    unsigned char *all = malloc(nblocks ? nblocks : 1);
+    unsigned char *near = malloc(nblocks ? nblocks : 1);
+    if(all == NULL || near == NULL){
+        free(all);
+        free(near);
+        return -1;
+    }
+
+    memset(blocks, 0, nblocks);
+    for(size_t i = 0; i < nlits; i++){
+        // all[k]: every trigram so far occurs in block k or k + 1
+        const unsigned char *lit = (const unsigned char *) lits[i];
+        size_t len = strlen(lits[i]);
+        memset(all, 1, nblocks);
+        for(size_t p = 0; p + 3 <= len; p++){
+            const idx_entry *e = find_entry(ix, trigram_at(lit + p));
+            if(e == NULL){
+                memset(all, 0, nblocks);
+                break;
+            }
+            memset(near, 0, nblocks);
+            const uint32_t *post = ix->postings + e->offset;
+            for(uint32_t j = 0; j < e->count; j++){
+                near[post[j]] = 1;
+                if(post[j] > 0) near[post[j] - 1] = 1;
+            }
+            for(uint32_t k = 0; k < nblocks; k++) all[k] &= near[k];
+        }
+        for(uint32_t k = 0; k < nblocks; k++) blocks[k] |= all[k];
+    }
+    free(all);
+    free(near);
+    return 0;
+}
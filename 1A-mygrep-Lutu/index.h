@@ -0,0 +1,93 @@
+/**
+ * @file index.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Trigram index of a file, stored next to it as a sidecar file (name of the file + IDX_SUFFIX).
+ * @details The file is divided into blocks of IDX_BLOCK bytes. For every trigram (three bytes, letters folded to lower case,
+ *          without newlines) the index lists the blocks in which the trigram starts. A search for a literal only has to
+ *          look at the blocks where all trigrams of the literal occur.
+ *          The sidecar file is used as it is through a memory mapping:
+ *          idx_header, then idx_entry[ntrigrams] sorted by trigram, then uint32_t postings[npostings] (block numbers).
+ *          The index stores size and modification time of the file and is ignored if they changed.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define IDX_SUFFIX ".mgi" /**< Appended to the file name to get the name of the index. */
+#define IDX_BLOCK (256 << 10) /**< Size of an indexed block (256 KiB). */
+#define IDX_MAGIC "MGI1" /**< First bytes of every index file. */
+
+/**
+ * @brief Start of an index file.
+ */
+typedef struct {
+    char magic[4]; /**< IDX_MAGIC */
+    uint32_t block_size; /**< Size of a block in bytes. */
+    uint64_t file_size; /**< Size of the indexed file. */
+    int64_t mtime_sec; /**< Modification time of the indexed file (seconds). */
+    int64_t mtime_nsec; /**< Modification time of the indexed file (nanoseconds). */
+    uint32_t ntrigrams; /**< Number of entries. */
+    uint32_t nblocks; /**< Number of blocks of the file. */
+    uint64_t npostings; /**< Number of block numbers in all posting lists. */
+} idx_header;
+
+/**
+ * @brief Posting list of one trigram.
+ */
+typedef struct {
+    uint32_t trigram; /**< The three bytes, first byte in bits 16-23. */
+    uint32_t count; /**< Number of blocks in the list. */
+    uint64_t offset; /**< Index of the first block number in postings. */
+} idx_entry;
+
+/**
+ * @brief Opened index file.
+ */
+typedef struct {
+    void *map; /**< Mapping of the index file. */
+    size_t map_size; /**< Size of the mapping. */
+    const idx_header *header; /**< Header at the start of map. */
+    const idx_entry *entries; /**< Sorted entries. */
+    const uint32_t *postings; /**< Block numbers of all posting lists. */
+} file_index;
+
+/**
+ * @brief Builds the index of a file and writes it next to the file.
+ * @param filename name of the file
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int idx_build(const char *filename);
+
+/**
+ * @brief Opens the index of a file if it exists and matches the file.
+ * @param ix index to open
+ * @param filename name of the indexed file
+ * @param st status of the indexed file
+ * @return 0 on success, -1 if there is no valid index for the file in its current state
+ */
+int idx_open(file_index *ix, const char *filename, const struct stat *st);
+
+/**
+ * @brief Closes an index opened with idx_open.
+ * @param ix index
+ */
+void idx_close(file_index *ix);
+
+/**
+ * @brief Marks the blocks in which a match of one of the literals can start.
+ * @details A match that starts in block k lies in blocks k and k + 1, because no literal is longer than a block.
+ * @param ix opened index
+ * @param lits literals, every matching line contains one of them
+ * @param nlits number of literals
+ * @param blocks set to 1 for every block in which a match can start, else 0 (length: number of blocks of the file)
+ * @return 0 on success, -1 if the index can not be used for these literals (shorter than 3 bytes, newline, too long)
+ */
+int idx_candidates(const file_index *ix, char *const *lits, size_t nlits, unsigned char *blocks);
+
+#endif
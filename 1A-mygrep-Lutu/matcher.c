@@ -0,0 +1,200 @@
+/**
+ * @file matcher.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Set of keywords searched by mygrep.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "matcher.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/**
+ * @brief Buffer an occurrence is tested against, context of in_bounds.
+ */
+typedef struct {
+    const char *start; /**< start of the buffer, also the start of a line */
+    const char *end; /**< end of the buffer */
+    match_bound bound; /**< where the occurrence has to lie */
+} bounds;
+
+/**
+ * @brief compiles regular expressions that only match within the bound: -x puts them between ^ and $,
+ *        -w between a non word character or the start of the line and a non word character or the end of the line
+ * @param keywords regular expressions
+ * @param n number of expressions
+ * @param case_insensitive nonzero if the search should be case insensitive
+ * @param bound where a match has to lie
+ * @param err set to an error message on failure
+ * @return compiled expression, NULL on error
+ */
+static rx *compile_bounded(char *const *keywords, size_t n, int case_insensitive, match_bound bound, const char **err){
+    if(bound == MATCH_ANY) return rx_compile(keywords, n, case_insensitive, err);
+
+    const char *head = (bound == MATCH_LINE) ? "^(" : "(^|\\W)(";
+    const char *tail = (bound == MATCH_LINE) ? ")$" : ")(\\W|$)";
+    char **wrapped = calloc(n > 0 ? n : 1, sizeof(char *));
+    rx *r = NULL;
+    size_t i = 0;
+    if(wrapped != NULL){
+        for(; i < n; i++){
+            wrapped[i] = malloc(strlen(head) + strlen(keywords[i]) + strlen(tail) + 1);
+            if(wrapped[i] == NULL) break;
+            strcat(strcat(strcpy(wrapped[i], head), keywords[i]), tail);
+        }
+    }
+    if(wrapped == NULL || i < n) *err = "Out of memory";
+    else r = rx_compile(wrapped, n, case_insensitive, err);
+    for(size_t k = 0; k < i; k++) free(wrapped[k]);
+    free(wrapped);
+    return r;
+}
+
+int matcher_init(matcher *m, char *const *keywords, size_t n, int case_insensitive, int extended, match_bound bound, const char **err){
+    m->multi = 0;
+    m->re = NULL;
+    m->prefilter = NULL;
+    m->bound = bound;
+
+    if(extended){
+        m->re = compile_bounded(keywords, n, case_insensitive, bound, err);
+        if(m->re == NULL) return -1;
+
+        char *const *lits;
+        size_t nlits = rx_literals(m->re, &lits);
+        if(nlits > 0){
+            m->prefilter = malloc(sizeof(matcher));
+            if(m->prefilter == NULL || matcher_init(m->prefilter, lits, nlits, case_insensitive, 0, MATCH_ANY, err) == -1){
+                free(m->prefilter);
+                m->prefilter = NULL; // the expression works without the literals, only slower
+            }
+        }
+        return 0;
+    }
+
+    char **kept = NULL;
+    if(bound != MATCH_ANY){
+        // a keyword with a newline never lies within a line, without it every occurrence does and the buffer is always searched from a line start
+        kept = malloc((n > 0 ? n : 1) * sizeof(char *));
+        if(kept == NULL){
+            *err = "Out of memory";
+            return -1;
+        }
+        size_t nkept = 0;
+        for(size_t i = 0; i < n; i++){
+            if(strchr(keywords[i], '\n') == NULL) kept[nkept++] = keywords[i];
+        }
+        keywords = kept;
+        n = nkept;
+    }
+
+    m->multi = (n != 1);
+    int ret = 0;
+    if(m->multi && ac_build(&m->ac, keywords, n, case_insensitive) == -1){
+        *err = "Out of memory";
+        ret = -1;
+    }
+    if(!m->multi) searcher_init(&m->s, keywords[0], case_insensitive);
+    free(kept);
+    return ret;
+}
+
+void matcher_free(matcher *m){
+    if(m->prefilter != NULL){
+        matcher_free(m->prefilter);
+        free(m->prefilter);
+    }
+    if(m->re != NULL) rx_free(m->re);
+    if(m->multi) ac_free(&m->ac);
+}
+
+/**
+ * @brief searches a regular expression, only in the lines that contain one of its literals
+ * @param m prepared regular expression with prefilter
+ * @param haystack buffer of lines
+ * @param len length of the buffer in bytes
+ * @return position in the first matching line, NULL if there is none
+ */
+static const char *find_prefiltered(const matcher *m, const char *haystack, size_t len){
+    const char *end = haystack + len;
+    const char *from = haystack; // always the start of a line
+    while(from < end){
+        size_t lit_len;
+        const char *hit = matcher_find(m->prefilter, from, end - from, &lit_len);
+        if(hit == NULL) return NULL;
+
+        const char *ls = hit;
+        while(ls > from && ls[-1] != '\n') ls--;
+        const char *le = memchr(hit, '\n', end - hit);
+        le = (le == NULL) ? end : le;
+        if(rx_find(m->re, ls, le - ls) != NULL) return ls;
+        from = le + 1;
+    }
+    return NULL;
+}
+
+/**
+ * @brief tests if a byte is a word character for -w
+ * @param c byte
+ * @return nonzero for letters, digits and '_'
+ */
+static int is_word(unsigned char c){
+    return isalnum(c) || c == '_';
+}
+
+/**
+ * @brief tests if an occurrence lies within the bound (ac_accept)
+ * @param ctx bounds of the searched buffer
+ * @param hit start of the occurrence
+ * @param len length of the occurrence
+ * @return nonzero if the occurrence is a match
+ */
+static int in_bounds(const void *ctx, const char *hit, size_t len){
+    const bounds *b = ctx;
+    const char *after = hit + len;
+    if(hit == b->end && (hit == b->start || hit[-1] == '\n')) return 0; // an empty occurrence after the last line is in no line
+    if(b->bound == MATCH_LINE) return (hit == b->start || hit[-1] == '\n') && (after == b->end || *after == '\n');
+    return (hit == b->start || !is_word(hit[-1])) && (after == b->end || !is_word(*after));
+}
+
+/**
+ * @brief searches the first occurrence of the fixed keywords that lies within the bound
+ * @details A rejected occurrence of a single keyword continues the search one byte after its start, with -x at the next line
+ *          because no later occurrence can start the line. Several keywords are tested while the automaton scans (ac_find_accepted).
+ * @param m prepared keywords with a bound
+ * @param haystack buffer of lines
+ * @param len length of the buffer in bytes
+ * @param match_len set to the length of the found keyword
+ * @return pointer to the first match, NULL if there is none
+ */
+static const char *find_bounded(const matcher *m, const char *haystack, size_t len, size_t *match_len){
+    bounds b = { haystack, haystack + len, m->bound };
+    if(m->multi) return ac_find_accepted(&m->ac, haystack, len, in_bounds, &b, match_len);
+
+    *match_len = m->s.len;
+    const char *from = haystack;
+    for(;;){
+        const char *hit = searcher_find(&m->s, from, b.end - from);
+        if(hit == NULL || in_bounds(&b, hit, m->s.len)) return hit;
+        if(m->bound == MATCH_LINE){
+            hit = memchr(hit, '\n', b.end - hit);
+            if(hit == NULL) return NULL;
+        }
+        if(hit == b.end) return NULL;
+        from = hit + 1;
+    }
+}
+
+const char *matcher_find(const matcher *m, const char *haystack, size_t len, size_t *match_len){
+    if(m->re != NULL){
+        *match_len = 0;
+        if(m->prefilter != NULL) return find_prefiltered(m, haystack, len);
+        return rx_find(m->re, haystack, len);
+    }
+    if(m->bound != MATCH_ANY) return find_bounded(m, haystack, len, match_len);
+    if(m->multi) return ac_find(&m->ac, haystack, len, match_len);
+    *match_len = m->s.len;
+    return searcher_find(&m->s, haystack, len);
+}
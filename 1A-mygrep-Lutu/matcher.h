@@ -0,0 +1,78 @@
+/**
+ * @file matcher.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Set of keywords searched by mygrep.
+ * @details A single keyword is searched with the vector kernels of search.h, several keywords with one
+ *          Aho-Corasick automaton (ac.h), so the input is read only once no matter how many keywords are given.
+ *          With -E the keywords are regular expressions (rx.h). If every match has to contain one of a few literals, these
+ *          literals are searched first and only the lines that contain one go through the regular expression.
+ *          With -w and -x an occurrence of a fixed keyword is only a match if it passes the boundary test, which is done when the
+ *          occurrence is found; a rejected occurrence does not end the search, the next one is tried. Regular expressions get
+ *          the boundaries as part of the expression.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <stddef.h>
+#include "search.h"
+#include "ac.h"
+#include "rx.h"
+
+typedef struct matcher matcher;
+
+/**
+ * @brief Where an occurrence of a keyword has to lie to be a match.
+ */
+typedef enum {
+    MATCH_ANY, /**< anywhere */
+    MATCH_WORD, /**< at the start of the line or after a byte that is no word character (letter, digit, '_'), and also so at its end (-w) */
+    MATCH_LINE /**< the occurrence is the whole line (-x) */
+} match_bound;
+
+/**
+ * @brief Prepared keywords.
+ */
+struct matcher {
+    int multi; /**< Nonzero if ac is used, else s. */
+    searcher s; /**< Single keyword. */
+    ac_automaton ac; /**< Several keywords (or none). */
+    rx *re; /**< Regular expression of all keywords (-E), NULL for fixed strings. */
+    matcher *prefilter; /**< Literals of re (fixed strings), NULL if re has none. */
+    match_bound bound; /**< Where an occurrence of a fixed keyword has to lie, regular expressions contain the bound. */
+};
+
+/**
+ * @brief Prepares the keywords for searching.
+ * @param m matcher to initialize
+ * @param keywords null terminated keywords. With a single keyword it must stay valid while m is used.
+ * @param n number of keywords, with 0 keywords nothing matches
+ * @param case_insensitive nonzero if the search should be case insensitive
+ * @param extended nonzero if the keywords are extended regular expressions
+ * @param bound where an occurrence has to lie to be a match
+ * @param err set to an error message on failure
+ * @return 0 on success, -1 if memory could not be allocated or a regular expression is not valid
+ */
+int matcher_init(matcher *m, char *const *keywords, size_t n, int case_insensitive, int extended, match_bound bound, const char **err);
+
+/**
+ * @brief Frees the memory of a matcher.
+ * @param m matcher prepared with matcher_init
+ */
+void matcher_free(matcher *m);
+
+/**
+ * @brief Searches the keywords in a buffer.
+ * @details For regular expressions and with a bound the buffer has to start at the start of a line. For regular expressions
+ *          the result is then a position in the first matching line and match_len is 0.
+ * @param m prepared keywords
+ * @param haystack buffer to search in, does not have to be null terminated
+ * @param len length of the buffer in bytes
+ * @param match_len set to the length of the found keyword
+ * @return pointer to the first occurrence, NULL if there is none
+ */
+const char *matcher_find(const matcher *m, const char *haystack, size_t len, size_t *match_len);
+
+#endif
@@ -1,205 +1,1355 @@
-/**
- * @file mygrep.c
- * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
- * @brief Implementation of a reduced variation of the Unix-command grep. Reads in several files and prints all lines containing a keyword
- * @details reduced version of the unix-command grep, input is a keyword, inputfiles or stdin, and a argument [i] if search should be case insensitive
- * @version 0.1
- * @date 2023-10-21
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <getopt.h>
-#include <assert.h>
-#include <string.h>
-#include <ctype.h>
-
-
-static void usage(void);
-static char *strcasestr(char *haystack, char *needle);
-static int grep_file(int case_insensitive, FILE* fout, char* keyword, char* filein);
-static int grep(int case_insensitive, FILE* fout, char* keyword);
-
-static char *prog_name; /**< char pointer to the name of the program. d.h. the name that is in the arguments at pos. 0  (argv[0]). Used for error messages */
-
-/**
- * @brief main function, parses arguments etc
- * @details Start of the program. function does the argument parsing with getopt of the arguments given in argv.
- * @param argc arguments count
- * @param argv arguments (first argument is the program name)
- * @return int
- */
-int main(int argc, char *argv[]) {
-    int opt;
-    int return_status = 0;
-    int case_insensitive = 0;
-    int use_stdin = 1;
-    char *output_file_str = NULL;
-    FILE *fout = stdout; //set fout to stdout. If no output file is specified, then stdout is used.
-    prog_name = argv[0];
-
-    //Going through options
-    while ((opt = getopt(argc, argv, "io:")) != -1) {
-        switch (opt) {
-            case 'i':
-                case_insensitive = 1;
-                break;
-            case 'o':
-                output_file_str = optarg;
-                break;
-            case '?':
-                usage();
-                return EXIT_FAILURE;
-            default:
-                assert(0); //should not happen!
-        }
-    }
-
-    char *keyword = NULL;
-    if (optind < argc) {
-        keyword = argv[optind];
-        optind++;
-    } else {
-        fprintf(stderr, "[%s] Error: No keyword specified.\n", argv[0]);
-        usage();
-        return EXIT_FAILURE;
-    }
-
-    if (output_file_str) {
-        fout = fopen(output_file_str, "w");
-
-        if(fout == NULL){
-            fprintf(stderr, "[%s] Error: [%s] Failed to write to file\n", argv[0], output_file_str);
-            return EXIT_FAILURE;
-        }
-    }
-
-    for (int i = optind; i < argc; i++) {
-        use_stdin = 0;
-        return_status |= grep_file(case_insensitive, fout, keyword, argv[i]); //for each input file, function is called: If function returns Error, error status is updated!
-    }
-
-    if (use_stdin) {
-        grep(case_insensitive, fout, keyword);
-    }
-    fclose(fout);
-    if(return_status > 0) return EXIT_FAILURE;
-    return EXIT_SUCCESS;
-}
-
-/**
- * @brief prints usage to stdout
- * @details This function prints information about how to use the program, including options and arguments.
- */
-static void usage(void) {
-    printf("Usage: %s [-i] [-o outfile] keyword [file...]\n", prog_name);
-    printf("[-i]: the program shall not differentiate between lower and upper case letters, i.e the search for the keyword in a line is case insensitive.\n");
-    printf("[-o outfile] If the option -o is given, the output is written to the specified file (outfile). Otherwise, the output is written to stdout.\n");
-    printf("keyword: keyword that the program searches for.\n");
-    printf("[file...]: name of input files. If no input file is specified, the program reads from stdin\n");
-}
-
-/**
- * @brief core function: logic of grep. prints all lines containing a keyword. Uses stdin
- * @detail This function reads input lines from stdin, searches for the specified keyword, and prints
- *         the lines containing the keyword to the specified output file. It can perform case-sensitive
- *         or case-insensitive searches based on the value of the 'case_insensitive' parameter. Reads global var prog_name
- * @param case_insensitive: should search be case insensitive
- * @param fout stream to write to
- * @param keyword searching this string
- * @return exit status
- */
-static int grep(int case_insensitive, FILE* fout, char* keyword){
-    char* input = NULL;
-    size_t input_size = 0;
-
-    while(getline(&input, &input_size, stdin) != -1){ // Runs till infinity, User can exit by pressing STRG C or STRG D to mark EOF
-        char *result = strstr(input, keyword);
-        if (case_insensitive) result = strcasestr(input, keyword);
-
-        if (result != NULL) {
-            fprintf(fout, "%s", input);
-        }
-    }
-    free(input); // With getline you have to free the dynamically allocated memory
-    return 0;
-}
-
-
-/**
- * @brief core function: logic of grep. prints all lines containing a keyword. Uses input file.
- * @detail This function reads input lines from the specified input file, searches for the specified keyword, and prints
- *         the lines containing the keyword to the specified output file. It can perform case-sensitive or case-insensitive
- *         searches based on the value of the 'case_insensitive' parameter. Reads global var prog_name
- * @param case_insensitive: should search be case insensitive
- * @param fout stream to write to
- * @param keyword searching this string
- * @param filein string filename
- * @return exit status
- */
-static int grep_file(int case_insensitive, FILE* fout, char* keyword, char* filein){
-    FILE *fin;
-    char* input = NULL;
-    size_t input_size = 0;
-
-    fin = fopen(filein, "r");
-
-    if(fin == NULL){
-        fprintf(stderr, "[%s] Error: [%s] No such file or directory\n", prog_name, filein);
-        return 1;
-    }
-    while(getline(&input, &input_size, fin) != -1){ // Runs till infinity, User can exit by pressing STRG C or STRG D to mark EOF
-        char *result = strstr(input, keyword);
-        if (case_insensitive) result = strcasestr(input, keyword);
-        if (result != NULL) {
-            fprintf(fout, "%s", input);
-        }
-    }
-    fclose(fin);
-    free(input);
-    return 0;
-}
-
-
-/**
- * @brief Function to search for a keyword inside another string case insensitive
- * @detail This function searches for the first occurrence of the specified substring (needle) within
- *         the given string (haystack) in a case-insensitive manner. It returns a pointer to the first
- *         occurrence of the substring in the string, or NULL if the substring is not found.
- * @param haystack string
- * @param needle keyword
- * @return return pointer to the beginning of the substring. NULL if not found.
- */
-static char *strcasestr(char *haystack, char *needle) {
-    if(*needle == '\0') return (char *) haystack;
-    char* res = NULL;
-    char lowerH = 0, lowerN = 0;
-
-    int found = 0;
-    while(*haystack != '\0' && !found){
-        lowerH = tolower(*haystack);
-        lowerN = tolower(*needle);
-        if(lowerH == lowerN){
-            char *continueN = needle, *continueH = haystack;
-            while(*continueN != '\0'){
-                lowerH = tolower(*continueH);
-                lowerN = tolower(*continueN);
-                if(lowerH != lowerN){
-                    break;
-                }
-                continueH++;
-                continueN++;
-            }
-            if(*continueN == '\0'){
-              found = 1;
-              break;
-            }
-        }
-        haystack++;
-    }
-
-    if(found){
-        res = haystack;
-    }
-    return res;
-}
+/**
+ * @file mygrep.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Implementation of a reduced variation of the Unix-command grep. Reads in several files and prints all lines containing a keyword
+ * @details reduced version of the unix-command grep, input is a keyword, inputfiles or stdin, and a argument [i] if search should be case insensitive
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <errno.h>
+#include <limits.h>
+#include "matcher.h"
+#include "pool.h"
+#include "output.h"
+#include "gzin.h"
+#include "index.h"
+#include "fetch.h"
+#include "walk.h"
+#include "stats.h"
+
+#define CHUNK_MIN (4 << 20) /**< Smallest byte range of a file that is searched by its own thread (4 MiB). */
+#define BINARY_SNIFF (32 << 10) /**< With -r a file is skipped as binary if its first bytes (32 KiB) contain a null byte. */
+#ifndef READ_BLOCK
+#define READ_BLOCK (1 << 20) /**< Size of the read buffer for stdin and other files that can not be mapped (1 MiB), can be set with -DREAD_BLOCK=... */
+#endif
+
+/**
+ * @brief What is printed for an input.
+ */
+typedef enum {
+    MODE_LINES, /**< every matching line */
+    MODE_COUNT, /**< the number of matching lines (-c) */
+    MODE_LIST /**< the name of the input if it has a matching line (-l), the search stops at the first match */
+} grep_mode;
+
+/**
+ * @brief Settings of the search, the same for every input.
+ */
+typedef struct {
+    const matcher *m; /**< prepared keywords */
+    grep_mode mode; /**< what is printed */
+    int with_names; /**< nonzero if the counts of -c are prefixed with the name of the input (more than one input file) */
+    char *const *lits; /**< literals of which every matching line contains one, used to skip blocks with an index */
+    size_t nlits; /**< number of literals, 0 if the index can not be used */
+    size_t before; /**< lines of context printed before every matching line (-B), only in MODE_LINES */
+    size_t after; /**< lines of context printed after every matching line (-A), only in MODE_LINES */
+    int context; /**< nonzero if -A, -B or -C was given in MODE_LINES, then groups of lines are separated by "--" (also with 0 lines) */
+    int skip_binary; /**< nonzero if regular files with a null byte in their first BINARY_SNIFF bytes are skipped (-r) */
+    int invert; /**< nonzero if the lines without a match are selected (-v) */
+} grep_opts;
+
+/**
+ * @brief Context output state of one input (-A, -B, -C).
+ * @details Lines are not remembered while searching. The lines before a match are found by scanning back from the match,
+ *          at most to hold, so context costs nothing until a match is found. Positions are offsets into the searched buffer.
+ */
+typedef struct {
+    size_t hold; /**< the before context may not start before this offset (end of the last printed line or start of the kept data) */
+    size_t after_left; /**< lines after the last matching line that are still to print */
+    int joined; /**< nonzero if the line at hold directly follows the last printed line */
+    int printed; /**< nonzero if a line of this input was printed, a gap before the next group is then marked with "--" */
+} context;
+
+/**
+ * @brief Input files of a parallel run, given to the worker pool as context.
+ */
+typedef struct {
+    const grep_opts *g; /**< search settings */
+    char **files; /**< names of the input files, job i searches files[i] */
+    stats *records; /**< job i measures into records[i] (--stats), NULL if nothing is measured */
+} file_jobs;
+
+/**
+ * @brief Byte ranges of one mapped file, given to the worker pool as context.
+ */
+typedef struct {
+    const grep_opts *g; /**< search settings */
+    const char *map; /**< start of the file image */
+    size_t *bounds; /**< chunk i is map[bounds[i]] to map[bounds[i+1]], every bound is the start of a line */
+    size_t *counts; /**< number of matching lines of every chunk */
+    int found; /**< set (atomically) when a chunk has a match in MODE_LIST, later chunks are then skipped */
+    stats *record; /**< record of the file the chunks are added to (--stats), NULL if nothing is measured */
+} chunk_jobs;
+
+/**
+ * @brief Keywords collected from -e and -f.
+ */
+typedef struct {
+    char **items; /**< the keywords, each allocated with malloc */
+    size_t count; /**< number of keywords */
+    size_t cap; /**< allocated length of items */
+} pattern_list;
+
+static void usage(void);
+static int parse_threads(const char *str);
+static int parse_lines(const char *str);
+static int add_pattern(pattern_list *list, const char *str, size_t len);
+static int add_patterns(pattern_list *list, const char *str);
+static int read_pattern_file(pattern_list *list, const char *filename);
+static void free_patterns(pattern_list *list);
+static int grep_file_job(void *ctx, int index, outbuf *out);
+static int grep_chunk_job(void *ctx, int index, outbuf *out);
+static int grep_file(const grep_opts* g, outbuf* fout, char* filein, int threads);
+static int grep_fd(const grep_opts* g, outbuf* fout, const char* filein, int fd, int threads);
+static int grep_files(const grep_opts* g, outbuf* fout, char** files, int n, stats* records);
+static int grep_fetched(const grep_opts* g, outbuf* fout, const char* filein, fetched* file);
+static int grep_chunked(const grep_opts* g, outbuf* fout, const char* map, size_t size, int threads, size_t* count);
+static int grep_indexed(const grep_opts* g, outbuf* fout, const char* filein, const struct stat* st, const char* map, int threads, size_t* count);
+static int build_indexes(char **files, int n);
+static int grep(const grep_opts* g, outbuf* fout);
+static int grep_stream(const grep_opts* g, outbuf* fout, int fd, gzin_reader* gz, int notify, size_t* count);
+static int grep_follow(const grep_opts* g, outbuf* fout, const char* filein);
+static int wait_appended(int fd, int notify);
+static int grep_mapped(const grep_opts* g, outbuf* fout, const char* map, size_t size, size_t* count);
+static int grep_inverted(const grep_opts* g, outbuf* fout, const char* map, size_t size, size_t* count);
+static int next_selected(const grep_opts* g, const char* pos, const char* end, const char** run_start, const char** run_end, size_t* lines);
+static int grep_context(const grep_opts* g, outbuf* fout, const char* map, size_t from, size_t size, size_t* count, context* cx);
+static int print_after(outbuf* fout, const char* map, size_t limit, context* cx);
+static int print_count(const grep_opts* g, outbuf* fout, const char* name, size_t count);
+static int looks_binary(const char* data, size_t size);
+static void count_scanned(stats* st, const char* data, size_t size, size_t count);
+static size_t count_lines(const char* data, size_t size);
+
+static char *prog_name; /**< char pointer to the name of the program. d.h. the name that is in the arguments at pos. 0  (argv[0]). Used for error messages */
+
+/**
+ * @brief main function, parses arguments etc
+ * @details Start of the program. function does the argument parsing with getopt of the arguments given in argv.
+ * @param argc arguments count
+ * @param argv arguments (first argument is the program name)
+ * @return int
+ */
+int main(int argc, char *argv[]) {
+    int opt;
+    int return_status = 0;
+    int build_index = 0;
+    int show_stats = 0;
+    int case_insensitive = 0;
+    int extended = 0;
+    int invert = 0;
+    match_bound bound = MATCH_ANY;
+    int threads = 1;
+    int follow = 0;
+    int recursive = 0;
+    int before = -1, after = -1, both = -1; // -A and -B win over -C
+    grep_mode mode = MODE_LINES;
+    int have_patterns = 0; // set if -e or -f was given, then there is no keyword argument
+    pattern_list patterns = { NULL, 0, 0 };
+    char *output_file_str = NULL;
+    int fd_out = STDOUT_FILENO; //set fd_out to stdout. If no output file is specified, then stdout is used.
+    prog_name = argv[0];
+
+    static const struct option long_options[] = {
+        { "index", no_argument, NULL, 'X' },
+        { "stats", no_argument, NULL, 'S' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    //Going through options
+    while ((opt = getopt_long(argc, argv, "io:j:e:f:clEFrvwxA:B:C:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'X':
+                build_index = 1;
+                break;
+            case 'S':
+                show_stats = 1;
+                break;
+            case 'i':
+                case_insensitive = 1;
+                break;
+            case 'E':
+                extended = 1;
+                break;
+            case 'v':
+                invert = 1;
+                break;
+            case 'w':
+                if (bound != MATCH_LINE) bound = MATCH_WORD; // -x wins over -w
+                break;
+            case 'x':
+                bound = MATCH_LINE;
+                break;
+            case 'F':
+                follow = 1;
+                break;
+            case 'r':
+                recursive = 1;
+                break;
+            case 'o':
+                output_file_str = optarg;
+                break;
+            case 'c':
+                if (mode != MODE_LIST) mode = MODE_COUNT; // -l wins over -c
+                break;
+            case 'l':
+                mode = MODE_LIST;
+                break;
+            case 'j':
+                if ((threads = parse_threads(optarg)) < 1) {
+                    fprintf(stderr, "[%s] Error: [%s] Invalid number of threads\n", argv[0], optarg);
+                    free_patterns(&patterns);
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'A':
+            case 'B':
+            case 'C': {
+                int lines = parse_lines(optarg);
+                if (lines < 0) {
+                    fprintf(stderr, "[%s] Error: [%s] Invalid number of context lines\n", argv[0], optarg);
+                    free_patterns(&patterns);
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                if (opt == 'A') after = lines;
+                else if (opt == 'B') before = lines;
+                else both = lines;
+                break;
+            }
+            case 'e':
+                have_patterns = 1;
+                if (add_patterns(&patterns, optarg) == -1) {
+                    fprintf(stderr, "[%s] Error: Out of memory\n", argv[0]);
+                    free_patterns(&patterns);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'f':
+                have_patterns = 1;
+                if (read_pattern_file(&patterns, optarg) == -1) {
+                    free_patterns(&patterns);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case '?':
+                free_patterns(&patterns);
+                usage();
+                return EXIT_FAILURE;
+            default:
+                assert(0); //should not happen!
+        }
+    }
+
+    if (build_index) {
+        // --index only builds the index of every file, nothing is searched
+        free_patterns(&patterns);
+        if (optind == argc) {
+            fprintf(stderr, "[%s] Error: No file specified.\n", argv[0]);
+            usage();
+            return EXIT_FAILURE;
+        }
+        return build_indexes(&argv[optind], argc - optind) ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    if (!have_patterns) {
+        if (optind < argc) {
+            // the keyword is used as it is, also if it contains a newline
+            if (add_pattern(&patterns, argv[optind], strlen(argv[optind])) == -1) {
+                fprintf(stderr, "[%s] Error: Out of memory\n", argv[0]);
+                return EXIT_FAILURE;
+            }
+            optind++;
+        } else {
+            fprintf(stderr, "[%s] Error: No keyword specified.\n", argv[0]);
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (follow && (argc - optind != 1 || mode == MODE_COUNT || recursive)) {
+        fprintf(stderr, "[%s] Error: -F needs exactly one input file and can not be combined with -c or -r\n", argv[0]);
+        free_patterns(&patterns);
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (output_file_str) {
+        fd_out = open(output_file_str, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+        if(fd_out == -1){
+            fprintf(stderr, "[%s] Error: [%s] Failed to write to file\n", argv[0], output_file_str);
+            free_patterns(&patterns);
+            return EXIT_FAILURE;
+        }
+    }
+
+    outbuf out;
+    matcher m;
+    if (out_init_fd(&out, fd_out) == -1) {
+        fprintf(stderr, "[%s] Error: Out of memory\n", argv[0]);
+        if (fd_out != STDOUT_FILENO) close(fd_out);
+        free_patterns(&patterns);
+        return EXIT_FAILURE;
+    }
+    const char *err;
+    if (matcher_init(&m, patterns.items, patterns.count, case_insensitive, extended, bound, &err) == -1) { // prepared once, used for every line/file
+        fprintf(stderr, "[%s] Error: %s\n", argv[0], err);
+        out_free(&out);
+        if (fd_out != STDOUT_FILENO) close(fd_out);
+        free_patterns(&patterns);
+        return EXIT_FAILURE;
+    }
+    outbuf *fout = &out;
+    grep_opts g = { &m, mode, argc - optind > 1, patterns.items, patterns.count };
+    g.invert = invert;
+    if (extended) {
+        // a regular expression can use the index only through the literals of its prefilter
+        g.nlits = (m.prefilter != NULL) ? rx_literals(m.re, &g.lits) : 0;
+    }
+    if (mode == MODE_LINES) {
+        // context is only printed with the lines, -c and -l ignore it
+        g.before = (before >= 0) ? before : (both >= 0) ? both : 0;
+        g.after = (after >= 0) ? after : (both >= 0) ? both : 0;
+        g.context = before >= 0 || after >= 0 || both >= 0;
+    }
+
+    char **files = &argv[optind];
+    int nfiles = argc - optind;
+    walk_result walked = { NULL, 0 };
+    if (recursive) {
+        // the directories are replaced by the files below them, without paths the working directory is searched
+        char *cwd[] = { "." };
+        int walk_status = walk_tree(nfiles > 0 ? files : cwd, nfiles > 0 ? nfiles : 1, threads > 1 ? threads : WALK_THREADS, &walked);
+        if (walk_status == -1 || walked.count > INT_MAX) {
+            fprintf(stderr, "[%s] Error: Out of memory\n", argv[0]);
+            return_status = 1;
+        }
+        return_status |= walk_status == 1;
+        files = walked.files;
+        nfiles = (int) walked.count;
+        g.with_names = nfiles > 1;
+        g.skip_binary = 1;
+    }
+
+    // --stats: one record per input, the work that belongs to no input (merging the output of the pool) goes to other
+    stats *records = NULL;
+    stats other = { NULL, 0, 0, 0, 0, 0, 0, 0, 0 };
+    uint64_t start = 0;
+    int nrecords = (!recursive && nfiles == 0) ? 1 : nfiles;
+    if (show_stats) {
+        records = calloc(nrecords > 0 ? nrecords : 1, sizeof(stats));
+        if (records == NULL) {
+            fprintf(stderr, "[%s] Error: Out of memory\n", argv[0]);
+            return_status = 1;
+        } else {
+            for (int i = 0; i < nrecords; i++) records[i].name = (nfiles == 0) ? "(standard input)" : files[i];
+            stats_bind(&other);
+            start = stats_clock(&other);
+        }
+    }
+
+    if (!recursive && nfiles == 0) {
+        stats_bind(records);
+        return_status |= grep(&g, fout);
+    } else if (follow) {
+        stats_bind(records);
+        return_status |= grep_follow(&g, fout, files[0]);
+    } else if (threads > 1 && nfiles > 1) {
+        // files are searched concurrently, the pool writes the results in the order of the arguments
+        file_jobs jobs = { &g, files, records };
+        return_status |= pool_run_ordered(nfiles, threads, grep_file_job, &jobs, fout);
+    } else if (nfiles > 1) {
+        // opening and reading of the next files overlaps with the search (fetch.h)
+        return_status |= grep_files(&g, fout, files, nfiles, records);
+    } else if (nfiles == 1) {
+        stats_bind(records);
+        return_status |= grep_file(&g, fout, files[0], threads);
+    }
+    stats_bind(records != NULL ? &other : NULL);
+    if (out_flush(fout) == -1 && return_status == 0) {
+        fprintf(stderr, "[%s] Error: Failed to write output\n", argv[0]);
+        return_status = 1;
+    }
+    if (records != NULL) {
+        stats_print(stderr, records, nrecords, &other, stats_clock(&other) - start);
+        stats_bind(NULL);
+        free(records);
+    }
+    out_free(fout);
+    if (fd_out != STDOUT_FILENO) close(fd_out);
+    walk_free(&walked);
+    matcher_free(&m);
+    free_patterns(&patterns);
+    if(return_status > 0) return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief prints usage to stdout
+ * @details This function prints information about how to use the program, including options and arguments.
+ */
+static void usage(void) {
+    printf("Usage: %s [-i] [-E] [-v] [-w | -x] [-c | -l] [-F] [-r] [-A num] [-B num] [-C num] [-o outfile] [-j threads] [--stats] {keyword | -e pattern... | -f patternfile...} [file...]\n", prog_name);
+    printf("       %s --index file...\n", prog_name);
+    printf("[-i]: the program shall not differentiate between lower and upper case letters, i.e the search for the keyword in a line is case insensitive.\n");
+    printf("[-E]: the keywords are extended regular expressions.\n");
+    printf("[-v]: select the lines that do not contain any keyword. -c, -l and context lines then refer to these lines.\n");
+    printf("[-w]: a keyword only matches as a whole word: not preceded or followed by a letter, digit or '_'.\n");
+    printf("[-x]: a keyword only matches the whole line. Wins over -w.\n");
+    printf("[-o outfile] If the option -o is given, the output is written to the specified file (outfile). Otherwise, the output is written to stdout.\n");
+    printf("[-c] print only the number of matching lines of every input.\n");
+    printf("[-l] print only the names of the inputs that contain a match. Reading an input stops at its first match.\n");
+    printf("[-F] follow a single growing file like tail -f: after its end the program waits for appended lines and searches them. It runs until it is interrupted (or with -l until the first match).\n");
+    printf("[-r] search the files below every directory given as file, the working directory if no file is given. Binary files are skipped.\n");
+    printf("[-A num] [-B num] print num lines of context after / before every matching line, [-C num] both. Groups of lines of an input that do not follow each other are separated by a line \"--\".\n");
+    printf("[-j threads] search up to this many input files at the same time. The output is the same as with one thread.\n");
+    printf("[--stats] write counters and timings of every input and of the whole search to stderr as JSON: bytes read, lines searched, matching lines, nanoseconds spent on input, matching and output, and system calls.\n");
+    printf("keyword: keyword that the program searches for.\n");
+    printf("[-e pattern] search for this keyword, can be given several times. A line is printed if it contains any of the keywords.\n");
+    printf("[-f patternfile] search for every line of patternfile as a keyword, can be combined with -e. There is no keyword argument if -e or -f is given.\n");
+    printf("[file...]: name of input files, gzip compressed files are decompressed. If no input file is specified, the program reads from stdin\n");
+    printf("--index: build a trigram index next to every file (file" IDX_SUFFIX "). Later searches only read the parts of the file that can match, until the file changes.\n");
+}
+
+/**
+ * @brief parses the argument of the options -A, -B and -C
+ * @param str argument string
+ * @return number of lines, -1 if str is not a number
+ */
+static int parse_lines(const char *str) {
+    char *end;
+    errno = 0;
+    long n = strtol(str, &end, 10);
+    if (errno != 0 || end == str || *end != '\0' || n < 0 || n > 1000000) return -1;
+    return (int) n;
+}
+
+/**
+ * @brief parses the argument of option -j
+ * @param str argument string
+ * @return number of threads, -1 if str is not a positive number
+ */
+static int parse_threads(const char *str) {
+    char *end;
+    errno = 0;
+    long n = strtol(str, &end, 10);
+    if (errno != 0 || end == str || *end != '\0' || n < 1 || n > 1024) return -1;
+    return (int) n;
+}
+
+/**
+ * @brief appends a copy of a keyword to the list
+ * @param list keyword list
+ * @param str start of the keyword, does not have to be null terminated
+ * @param len length of the keyword
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+static int add_pattern(pattern_list *list, const char *str, size_t len) {
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 8;
+        char **items = realloc(list->items, cap * sizeof(char *));
+        if (items == NULL) return -1;
+        list->items = items;
+        list->cap = cap;
+    }
+    char *copy = malloc(len + 1);
+    if (copy == NULL) return -1;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    list->items[list->count++] = copy;
+    return 0;
+}
+
+/**
+ * @brief appends the argument of option -e to the list
+ * @details like in grep, an argument that contains newlines is split into one keyword per line
+ * @param list keyword list
+ * @param str argument string
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+static int add_patterns(pattern_list *list, const char *str) {
+    const char *nl;
+    while ((nl = strchr(str, '\n')) != NULL) {
+        if (add_pattern(list, str, nl - str) == -1) return -1;
+        str = nl + 1;
+    }
+    return add_pattern(list, str, strlen(str));
+}
+
+/**
+ * @brief appends every line of a file to the list (option -f)
+ * @param list keyword list
+ * @param filename name of the pattern file
+ * @return 0 on success, -1 on error (an error message is already printed)
+ */
+static int read_pattern_file(pattern_list *list, const char *filename) {
+    FILE *fin = fopen(filename, "r");
+    if (fin == NULL) {
+        fprintf(stderr, "[%s] Error: [%s] No such file or directory\n", prog_name, filename);
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t line_len;
+    int ret = 0;
+    while ((line_len = getline(&line, &line_size, fin)) != -1) {
+        if (line_len > 0 && line[line_len - 1] == '\n') line_len--;
+        if (add_pattern(list, line, line_len) == -1) {
+            fprintf(stderr, "[%s] Error: Out of memory\n", prog_name);
+            ret = -1;
+            break;
+        }
+    }
+    free(line);
+    fclose(fin);
+    return ret;
+}
+
+/**
+ * @brief frees all keywords of the list
+ * @param list keyword list
+ */
+static void free_patterns(pattern_list *list) {
+    for (size_t i = 0; i < list->count; i++) free(list->items[i]);
+    free(list->items);
+    list->items = NULL;
+    list->count = list->cap = 0;
+}
+
+/**
+ * @brief job function for the worker pool, searches one input file
+ * @param ctx file_jobs
+ * @param index index of the file
+ * @param out output buffer the job writes its matches to
+ * @return exit status of grep_file
+ */
+static int grep_file_job(void *ctx, int index, outbuf *out) {
+    file_jobs *jobs = ctx;
+    stats *prev = stats_bind(jobs->records != NULL ? &jobs->records[index] : NULL);
+    int ret = grep_file(jobs->g, out, jobs->files[index], 1);
+    stats_bind(prev);
+    return ret;
+}
+
+/**
+ * @brief job function for the worker pool, searches one chunk of a mapped file
+ * @param ctx chunk_jobs
+ * @param index index of the chunk
+ * @param out output buffer the job writes its matches to
+ * @return exit status of grep_mapped
+ */
+static int grep_chunk_job(void *ctx, int index, outbuf *out) {
+    chunk_jobs *jobs = ctx;
+    if (jobs->g->mode == MODE_LIST && __atomic_load_n(&jobs->found, __ATOMIC_RELAXED)) return 0; // an earlier chunk already decided
+    // chunks of the same file run at the same time, each measures on its own and adds the result at the end
+    stats chunk = { NULL, 0, 0, 0, 0, 0, 0, 0, 0 };
+    stats *prev = stats_bind(jobs->record != NULL ? &chunk : NULL);
+    int ret = grep_mapped(jobs->g, out, jobs->map + jobs->bounds[index], jobs->bounds[index + 1] - jobs->bounds[index], &jobs->counts[index]);
+    stats_bind(prev);
+    if (jobs->record != NULL) stats_add(jobs->record, &chunk);
+    if (jobs->counts[index] > 0) __atomic_store_n(&jobs->found, 1, __ATOMIC_RELAXED);
+    return ret;
+}
+
+/**
+ * @brief core function: logic of grep. prints all lines containing a keyword. Uses stdin
+ * @detail This function reads input lines from stdin, searches for the specified keyword, and prints
+ *         the lines containing the keyword to the specified output file. It can perform case-sensitive
+ *         or case-insensitive searches depending on how the matcher was prepared. Reads global var prog_name
+ * @param g search settings, the keywords decide if the search is case insensitive
+ * @param fout output buffer to write to
+ * @return exit status
+ */
+static int grep(const grep_opts* g, outbuf* fout){
+    size_t count = 0;
+    int ret = grep_stream(g, fout, STDIN_FILENO, NULL, -1, &count); // Runs till infinity, User can exit by pressing STRG C or STRG D to mark EOF
+    if(ret == 0) ret = print_count(g, fout, "(standard input)", count);
+    return ret;
+}
+
+/**
+ * @brief prints the result of -c or -l for one input, does nothing in MODE_LINES
+ * @param g search settings
+ * @param fout output buffer to write to
+ * @param name name of the input
+ * @param count number of matching lines of the input (with -l only 0 or 1)
+ * @return exit status
+ */
+static int print_count(const grep_opts* g, outbuf* fout, const char* name, size_t count){
+    char line[32];
+    int ret = 0;
+    if(g->mode == MODE_COUNT){
+        if(g->with_names) ret |= out_copy(fout, name, strlen(name)) | out_copy(fout, ":", 1);
+        int len = snprintf(line, sizeof(line), "%zu\n", count);
+        ret |= out_copy(fout, line, len);
+    } else if(g->mode == MODE_LIST && count > 0){
+        ret |= out_copy(fout, name, strlen(name)) | out_copy(fout, "\n", 1);
+    }
+    if(ret != 0){
+        fprintf(stderr, "[%s] Error: Failed to write output\n", prog_name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief searches a file and then every line that is appended to it (-F)
+ * @details The file is read block wise by grep_stream from the current offset, so appended data is read once and never searched again.
+ *          At the end of the file the process blocks on inotify until the file is modified.
+ * @param g search settings
+ * @param fout output buffer to write to
+ * @param filein name of the file
+ * @return exit status, only returns on an error or with -l
+ */
+static int grep_follow(const grep_opts* g, outbuf* fout, const char* filein){
+    int fd = open(filein, O_RDONLY);
+    if(fd == -1){
+        fprintf(stderr, "[%s] Error: [%s] No such file or directory\n", prog_name, filein);
+        return 1;
+    }
+    int notify = inotify_init1(IN_CLOEXEC);
+    if(notify == -1 || inotify_add_watch(notify, filein, IN_MODIFY | IN_ATTRIB) == -1){
+        fprintf(stderr, "[%s] Error: [%s] Failed to watch file\n", prog_name, filein);
+        if(notify != -1) close(notify);
+        close(fd);
+        return 1;
+    }
+    size_t count = 0;
+    int ret = grep_stream(g, fout, fd, NULL, notify, &count);
+    close(notify);
+    close(fd);
+    if(ret == 0) ret = print_count(g, fout, filein, count);
+    return ret;
+}
+
+/**
+ * @brief waits until data is appended to a followed file
+ * @param fd followed file, positioned after the data read so far
+ * @param notify inotify descriptor watching the file
+ * @return 0 if there is new data, 1 if the file was truncated (fd is then positioned at the start), -1 on error
+ */
+static int wait_appended(int fd, int notify){
+    union {
+        struct inotify_event event;
+        char buf[4096];
+    } events;
+    // the time spent waiting for the writer is counted as input time (--stats)
+    stats *rec = stats_current();
+    uint64_t since = stats_clock(rec);
+    unsigned calls = 0;
+    int ret;
+    for(;;){
+        // the events are queued since the watch was added, a change after the check below wakes the read
+        struct stat st;
+        off_t pos = lseek(fd, 0, SEEK_CUR);
+        calls += 2;
+        if(pos == -1 || fstat(fd, &st) == -1){
+            ret = -1;
+            break;
+        }
+        if(st.st_size < pos){
+            calls++;
+            ret = lseek(fd, 0, SEEK_SET) == -1 ? -1 : 1;
+            break;
+        }
+        if(st.st_size > pos){
+            ret = 0;
+            break;
+        }
+        calls++;
+        if(read(notify, events.buf, sizeof(events.buf)) == -1 && errno != EINTR){
+            ret = -1;
+            break;
+        }
+    }
+    stats_io(rec, since, calls);
+    return ret;
+}
+
+/**
+ * @brief block wise search on a file descriptor. Used for stdin, pipes and everything else that can not be mapped
+ * @details Reads the input with read into a buffer of READ_BLOCK bytes. All complete lines in the buffer are searched at once
+ *          with grep_mapped, the incomplete last line is moved to the front of the buffer and completed by the next read.
+ *          The buffer grows if a single line does not fit into it. The output is flushed after every block because it
+ *          references the buffer, this also shows the matches of an interactive input right away.
+ *          With -l reading stops after the first match.
+ *          With -B the last lines of a block that are not printed yet stay in the buffer as well, a match at the start of the
+ *          next block can print them as context. They are not searched again.
+ * @param g search settings, the keywords decide if the search is case insensitive
+ * @param fout output buffer to write to
+ * @param fd file descriptor to read from
+ * @param gz if not NULL the input is read decompressed from gz instead of from fd
+ * @param notify inotify descriptor watching fd for -F, the end of the file is then not the end of the input: the function waits
+ *        for appended data and only returns on an error or with -l after a match. -1 otherwise.
+ * @param count set to the number of matching lines
+ * @return exit status
+ */
+static int grep_stream(const grep_opts* g, outbuf* fout, int fd, gzin_reader* gz, int notify, size_t* count){
+    size_t cap = READ_BLOCK;
+    size_t len = 0; // bytes in buf: the kept lines, then the line that is not complete yet
+    size_t kept = 0; // complete lines at the start of buf that are kept for the before context, already searched
+    context cx = { 0, 0, 0, 0 };
+    char *buf = malloc(cap);
+    if(buf == NULL){
+        fprintf(stderr, "[%s] Error: Out of memory\n", prog_name);
+        return 1;
+    }
+
+    int ret = 0;
+    int eof = 0;
+    *count = 0;
+    while(!eof && ret == 0 && !(g->mode == MODE_LIST && *count > 0)){
+        if(len == cap){
+            char *bigger = realloc(buf, cap * 2);
+            if(bigger == NULL){
+                fprintf(stderr, "[%s] Error: Out of memory\n", prog_name);
+                ret = 1;
+                break;
+            }
+            buf = bigger;
+            cap *= 2;
+        }
+        stats *st = stats_current();
+        uint64_t since = stats_clock(st);
+        ssize_t n = (gz != NULL) ? gzin_read(gz, buf + len, cap - len) : read(fd, buf + len, cap - len);
+        stats_io(st, since, gz == NULL);
+        if(st != NULL && n > 0) st->bytes += n;
+        if(n == -1){
+            if(gz == NULL && errno == EINTR) continue;
+            fprintf(stderr, "[%s] Error: Failed to %s input\n", prog_name, (gz != NULL) ? "decompress" : "read");
+            ret = 1;
+            break;
+        }
+        if(n == 0 && notify != -1){
+            int waited = wait_appended(fd, notify);
+            if(waited == -1){
+                fprintf(stderr, "[%s] Error: Failed to follow input\n", prog_name);
+                ret = 1;
+                break;
+            }
+            if(waited == 1){
+                // truncated (rotated with copytruncate), the carried bytes are gone, the file is read again from the start
+                len = kept = 0;
+                cx.hold = cx.after_left = 0;
+                cx.joined = 0;
+            }
+            continue;
+        }
+        if(n == 0) eof = 1;
+
+        size_t old = len;
+        len += n;
+        size_t complete = len; // at the end of the input the last line is complete even without newline
+        if(!eof){
+            // only the new bytes can contain a newline, the carried bytes are one incomplete line
+            while(complete > old && buf[complete - 1] != '\n') complete--;
+            if(complete == old) continue;
+        }
+        if(complete == kept) continue;
+
+        size_t block_count;
+        if(g->context) ret = grep_context(g, fout, buf, kept, complete, &block_count, &cx);
+        else ret = grep_mapped(g, fout, buf, complete, &block_count);
+        *count += block_count;
+        if(ret == 0 && out_flush(fout) == -1){
+            fprintf(stderr, "[%s] Error: Failed to write output\n", prog_name);
+            ret = 1;
+        }
+
+        size_t drop = complete;
+        if(g->context){
+            // up to g->before lines that are not printed yet are kept
+            for(size_t n = 0; n < g->before && drop > cx.hold; n++){
+                drop--;
+                while(drop > cx.hold && buf[drop - 1] != '\n') drop--;
+            }
+            if(drop > cx.hold) cx.joined = 0; // unprinted lines are dropped
+            cx.hold = 0;
+            kept = complete - drop;
+        }
+        memmove(buf, buf + drop, len - drop);
+        len -= drop;
+    }
+    free(buf);
+    return ret;
+}
+
+
+/**
+ * @brief core function: logic of grep. prints all lines containing a keyword. Uses input file.
+ * @detail This function reads input lines from the specified input file, searches for the specified keyword, and prints
+ *         the lines containing the keyword to the specified output file. It can perform case-sensitive or case-insensitive
+ *         searches depending on how the matcher was prepared. Reads global var prog_name.
+ *         Regular files are mapped into memory and searched with grep_mapped, other files (fifos, devices) are read block wise (grep_stream).
+ *         Large mapped files are split into chunks that are searched by several threads (grep_chunked).
+ *         Gzip compressed regular files are decompressed by a separate thread (gzin.h) and searched block wise.
+ *         With -c or -l only the count or the name of the file is printed (print_count).
+ * @param g search settings, the keywords decide if the search is case insensitive
+ * @param fout output buffer to write to
+ * @param filein string filename
+ * @param threads number of threads that may search chunks of the file at the same time
+ * @return exit status
+ */
+static int grep_file(const grep_opts* g, outbuf* fout, char* filein, int threads){
+    stats *rec = stats_current();
+    uint64_t since = stats_clock(rec);
+    int fd = open(filein, O_RDONLY);
+    stats_io(rec, since, 1);
+    if(fd == -1){
+        fprintf(stderr, "[%s] Error: [%s] No such file or directory\n", prog_name, filein);
+        return 1;
+    }
+    return grep_fd(g, fout, filein, fd, threads);
+}
+
+/**
+ * @brief searches an opened input file, see grep_file
+ * @param g search settings
+ * @param fout output buffer to write to
+ * @param filein name of the file
+ * @param fd file descriptor of the file, closed by the function
+ * @param threads number of threads that may search chunks of the file at the same time
+ * @return exit status
+ */
+static int grep_fd(const grep_opts* g, outbuf* fout, const char* filein, int fd, int threads){
+    stats *rec = stats_current();
+    uint64_t since = stats_clock(rec);
+    struct stat st;
+    if(fstat(fd, &st) == -1){
+        fprintf(stderr, "[%s] Error: [%s] Failed to stat file\n", prog_name, filein);
+        close(fd);
+        return 1;
+    }
+
+    // regular files are mapped and searched in one pass, everything else (fifos, devices) is read block wise
+    size_t count = 0;
+    int gz_input = S_ISREG(st.st_mode) && gzin_detect(fd);
+    stats_io(rec, since, 1 + S_ISREG(st.st_mode));
+    if(gz_input){
+        gzin_reader *gz = gzin_open(fd);
+        if(gz == NULL){
+            fprintf(stderr, "[%s] Error: [%s] Failed to start decompression\n", prog_name, filein);
+            close(fd);
+            return 1;
+        }
+        int ret = grep_stream(g, fout, fd, gz, -1, &count);
+        since = stats_clock(rec);
+        gzin_close(gz);
+        close(fd);
+        stats_io(rec, since, 1);
+        if(ret == 0) ret = print_count(g, fout, filein, count);
+        return ret;
+    }
+
+    if(S_ISREG(st.st_mode)){
+        int ret = 0;
+        if(st.st_size > 0){
+            since = stats_clock(rec);
+            char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(map == MAP_FAILED){
+                fprintf(stderr, "[%s] Error: [%s] Failed to map file\n", prog_name, filein);
+                close(fd);
+                return 1;
+            }
+            if(rec != NULL) rec->bytes += st.st_size;
+            if(g->skip_binary && looks_binary(map, st.st_size)){
+                munmap(map, st.st_size);
+                close(fd);
+                stats_io(rec, since, 3);
+                return print_count(g, fout, filein, 0); // like grep -I, -c still prints 0
+            }
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            stats_io(rec, since, 2);
+            ret = grep_indexed(g, fout, filein, &st, map, threads, &count);
+            // the output references lines of the mapping, it has to be written before the mapping is removed
+            if(out_flush(fout) == -1 && ret == 0){
+                fprintf(stderr, "[%s] Error: Failed to write output\n", prog_name);
+                ret = 1;
+            }
+            since = stats_clock(rec);
+            munmap(map, st.st_size);
+            stats_io(rec, since, 1);
+        }
+        since = stats_clock(rec);
+        close(fd);
+        stats_io(rec, since, 1);
+        if(ret == 0) ret = print_count(g, fout, filein, count);
+        return ret;
+    }
+
+    int ret = grep_stream(g, fout, fd, NULL, -1, &count);
+    since = stats_clock(rec);
+    close(fd);
+    stats_io(rec, since, 1);
+    if(ret == 0) ret = print_count(g, fout, filein, count);
+    return ret;
+}
+
+/**
+ * @brief searches several input files one after another while the following files are opened and read ahead
+ * @param g search settings
+ * @param fout output buffer to write to
+ * @param files names of the files
+ * @param n number of files
+ * @param records file i is measured into records[i] (--stats), NULL if nothing is measured
+ * @return exit status
+ */
+static int grep_files(const grep_opts* g, outbuf* fout, char** files, int n, stats* records){
+    int ret = 0;
+    stats *prev = stats_current();
+    fetcher *f = fetch_start(files, n);
+    if(f == NULL){
+        for(int i = 0; i < n; i++){
+            stats_bind(records != NULL ? &records[i] : NULL);
+            ret |= grep_file(g, fout, files[i], 1); //for each input file, function is called: If function returns Error, error status is updated!
+        }
+        stats_bind(prev);
+        return ret;
+    }
+    for(int i = 0; i < n; i++){
+        stats *rec = (records != NULL) ? &records[i] : NULL;
+        stats_bind(rec);
+        uint64_t since = stats_clock(rec);
+        fetched *file = fetch_next(f); // waiting for the read ahead is input time
+        stats_io(rec, since, 0);
+        ret |= grep_fetched(g, fout, files[i], file);
+        since = stats_clock(rec);
+        unsigned calls = file->fd != -1; // the descriptor is closed if the search did not take it
+        fetch_done(f, file);
+        stats_io(rec, since, calls);
+    }
+    stats_bind(prev);
+    fetch_stop(f);
+    return ret;
+}
+
+/**
+ * @brief searches a file from the fetcher, a small file that was read completely is searched in memory
+ * @param g search settings
+ * @param fout output buffer to write to
+ * @param filein name of the file
+ * @param file opened file, the descriptor is taken over if the file has to be read
+ * @return exit status
+ */
+static int grep_fetched(const grep_opts* g, outbuf* fout, const char* filein, fetched* file){
+    if(file->fd == -1){
+        fprintf(stderr, "[%s] Error: [%s] No such file or directory\n", prog_name, filein);
+        return 1;
+    }
+    const unsigned char *data = (const unsigned char *) file->data;
+    if(data == NULL || (file->size >= 2 && data[0] == 0x1f && data[1] == 0x8b)){
+        int fd = file->fd; // large, special or gzip compressed files take the normal path
+        file->fd = -1;
+        return grep_fd(g, fout, filein, fd, 1);
+    }
+    stats *rec = stats_current();
+    if(rec != NULL) rec->bytes += file->size;
+    if(g->skip_binary && looks_binary(file->data, file->size)) return print_count(g, fout, filein, 0);
+
+    // the lines are copied, so the buffer can be released without writing the output of every small file at once
+    size_t count = 0;
+    outbuf lines;
+    out_init_mem(&lines);
+    int ret = grep_mapped(g, &lines, file->data, file->size, &count);
+    size_t size;
+    char *buf = out_take(&lines, &size);
+    if(ret == 0 && (lines.error || out_copy(fout, buf, size) == -1)){
+        fprintf(stderr, "[%s] Error: Failed to write output\n", prog_name);
+        ret = 1;
+    }
+    free(buf);
+    if(ret == 0) ret = print_count(g, fout, filein, count);
+    return ret;
+}
+
+/**
+ * @brief builds the index of every file (--index)
+ * @param files names of the files
+ * @param n number of files
+ * @return exit status
+ */
+static int build_indexes(char **files, int n){
+    int ret = 0;
+    for(int i = 0; i < n; i++){
+        if(idx_build(files[i]) == -1){
+            fprintf(stderr, "[%s] Error: [%s] Failed to build index: %s\n", prog_name, files[i], strerror(errno));
+            ret = 1;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief searches only the parts of a file image that can contain a match according to the index of the file
+ * @details Every block in which a literal can start is widened to whole lines up to the end of the next block (a match can
+ *          reach into it) and overlapping ranges are merged, so every line is searched at most once and in file order.
+ *          Without literals, without a valid index, if the literals are not usable with it or with -v, the whole image is searched.
+ * @param g search settings
+ * @param fout output buffer to write to
+ * @param filein name of the file
+ * @param st status of the file
+ * @param map start of the file image
+ * @param threads number of worker threads
+ * @param count set to the number of matching lines
+ * @return exit status
+ */
+static int grep_indexed(const grep_opts* g, outbuf* fout, const char* filein, const struct stat* st, const char* map, int threads, size_t* count){
+    size_t size = st->st_size;
+    file_index ix;
+    if(g->nlits == 0 || g->context || g->invert || idx_open(&ix, filein, st) == -1){
+        // context lines lie outside of the candidate ranges, with -v the skipped blocks are the selected lines
+        return grep_chunked(g, fout, map, size, threads, count);
+    }
+
+    size_t nblocks = ix.header->nblocks;
+    size_t block = ix.header->block_size;
+    unsigned char *blocks = malloc(nblocks);
+    if(blocks == NULL || idx_candidates(&ix, g->lits, g->nlits, blocks) == -1){
+        free(blocks);
+        idx_close(&ix);
+        return grep_chunked(g, fout, map, size, threads, count);
+    }
+    idx_close(&ix);
+
+    int ret = 0;
+    *count = 0;
+    size_t k = 0;
+    while(k < nblocks && ret == 0 && !(g->mode == MODE_LIST && *count > 0)){
+        if(!blocks[k]){
+            k++;
+            continue;
+        }
+        size_t from = k * block;
+        while(from > 0 && map[from - 1] != '\n') from--;
+        size_t to;
+        do {
+            to = (k + 2) * block;
+            if(to > size) to = size;
+            const char *nl = memchr(map + to - 1, '\n', size - to + 1);
+            to = (nl == NULL) ? size : (size_t) (nl - map) + 1;
+            k++;
+            while(k < nblocks && !blocks[k]) k++;
+        } while(k < nblocks && k * block < to); // the next range starts in this one: merge them
+
+        size_t c;
+        ret = grep_chunked(g, fout, map + from, to - from, threads, &c);
+        *count += c;
+    }
+    free(blocks);
+    return ret;
+}
+
+/**
+ * @brief splits a file image into chunks of whole lines and searches them in parallel
+ * @details The file is cut at about every size/n bytes, each cut is moved to the start of the next line. The chunks are
+ *          searched by the worker pool and their output is written in file order, so it is the same as from grep_mapped on the whole file.
+ *          Files smaller than two chunks of CHUNK_MIN bytes are searched by the calling thread.
+ *          With -l a chunk is not searched any more once an earlier started chunk had a match.
+ * @param g search settings, the keywords decide if the search is case insensitive
+ * @param fout output buffer to write to
+ * @param map start of the file image
+ * @param size size of the file image in bytes
+ * @param threads number of worker threads
+ * @param count set to the number of matching lines
+ * @return exit status
+ */
+static int grep_chunked(const grep_opts* g, outbuf* fout, const char* map, size_t size, int threads, size_t* count){
+    size_t nchunks = size / CHUNK_MIN;
+    if(nchunks > (size_t) threads * 4) nchunks = (size_t) threads * 4; // a few chunks per thread, so slow chunks even out
+    if(threads < 2 || nchunks < 2 || g->context) return grep_mapped(g, fout, map, size, count); // context reaches over chunk bounds
+
+    size_t *bounds = malloc((nchunks + 1) * sizeof(size_t));
+    size_t *counts = calloc(nchunks, sizeof(size_t));
+    if(bounds == NULL || counts == NULL){
+        free(bounds);
+        free(counts);
+        return grep_mapped(g, fout, map, size, count);
+    }
+    bounds[0] = 0;
+    for(size_t i = 1; i < nchunks; i++){
+        size_t cut = size / nchunks * i;
+        if(cut < bounds[i - 1]) cut = bounds[i - 1];
+        const char *nl = memchr(map + cut, '\n', size - cut);
+        bounds[i] = (nl == NULL) ? size : (size_t) (nl - map) + 1;
+    }
+    bounds[nchunks] = size;
+
+    chunk_jobs jobs = { g, map, bounds, counts, 0, stats_current() };
+    int ret = pool_run_ordered((int) nchunks, threads, grep_chunk_job, &jobs, fout);
+    *count = 0;
+    for(size_t i = 0; i < nchunks; i++) *count += counts[i];
+    free(bounds);
+    free(counts);
+    return ret;
+}
+
+/**
+ * @brief searches a whole file image at once and prints the lines around every hit
+ * @details Instead of splitting the input into lines first, the keyword is searched in the complete buffer.
+ *          Line boundaries are only computed around a hit, the line is added to the output as a range of the buffer (not copied) and the
+ *          search continues after the end of that line. A hit that reaches over the end of its line (keyword contains a newline)
+ *          is not a match, the search then continues one byte after the hit.
+ *          With -c the matching lines are only counted, with -l the search stops at the first matching line.
+ *          With context lines the buffer is searched by grep_context, with -v by grep_inverted.
+ * @param g search settings, the keywords decide if the search is case insensitive
+ * @param fout output buffer to write to
+ * @param map start of the file image
+ * @param size size of the file image in bytes
+ * @param count set to the number of matching lines
+ * @return exit status
+ */
+static int grep_mapped(const grep_opts* g, outbuf* fout, const char* map, size_t size, size_t* count){
+    if(g->context){
+        context cx = { 0, 0, 0, 0 };
+        return grep_context(g, fout, map, 0, size, count, &cx);
+    }
+    if(g->invert) return grep_inverted(g, fout, map, size, count);
+    stats *rec = stats_current();
+    uint64_t since = stats_match_start(rec);
+    const char *end = map + size;
+    const char *line = map; // start of the line the search position is in
+    const char *from = map;
+    const char *stop = end; // end of the searched lines
+
+    *count = 0;
+    while(from < end){
+        size_t match_len;
+        const char *hit = matcher_find(g->m, from, end - from, &match_len);
+        if(hit == NULL) break;
+
+        const char *le = memchr(hit, '\n', end - hit);
+        le = (le == NULL) ? end : le + 1;
+
+        if(hit + match_len > le){
+            from = hit + 1;
+            continue;
+        }
+        (*count)++;
+        if(g->mode == MODE_LIST){
+            stop = le;
+            break;
+        }
+        if(g->mode == MODE_LINES){
+            // the start of the line is only needed for printing it
+            const char *ls = hit;
+            while(ls > line && ls[-1] != '\n') ls--;
+            if(out_put(fout, ls, le - ls) == -1){
+                fprintf(stderr, "[%s] Error: Failed to write output\n", prog_name);
+                return 1;
+            }
+        }
+        line = from = le;
+    }
+    stats_match(rec, since);
+    count_scanned(rec, map, stop - map, *count);
+    return 0;
+}
+
+/**
+ * @brief prints the lines after the last matching line that are still missing, but not beyond limit
+ * @param fout output buffer to write to
+ * @param map start of the buffer
+ * @param limit offset of the end of the usable lines
+ * @param cx context state
+ * @return 0 on success, -1 on error
+ */
+static int print_after(outbuf* fout, const char* map, size_t limit, context* cx){
+    size_t end = cx->hold;
+    while(cx->after_left > 0 && end < limit){
+        const char *nl = memchr(map + end, '\n', limit - end);
+        end = (nl == NULL) ? limit : (size_t) (nl - map) + 1;
+        cx->after_left--;
+    }
+    if(end == cx->hold) return 0;
+    int ret = out_put(fout, map + cx->hold, end - cx->hold);
+    cx->hold = end;
+    cx->joined = 1;
+    return ret;
+}
+
+/**
+ * @brief searches the next run of selected lines: a matching line, with -v the lines up to the next matching line
+ * @details With -v only the matching lines are searched, the lines between them are selected as one range without looking at them.
+ * @param g search settings
+ * @param pos start of a line where the search starts
+ * @param end end of the buffer
+ * @param run_start set to the start of the first selected line
+ * @param run_end set to the end of the last selected line (after its newline)
+ * @param lines set to the number of selected lines, if not NULL (with -v they have to be counted)
+ * @return nonzero if a run was found, 0 if there are no selected lines after pos
+ */
+static int next_selected(const grep_opts* g, const char* pos, const char* end, const char** run_start, const char** run_end, size_t* lines){
+    const char *from = pos;
+    while(pos < end){
+        size_t match_len;
+        const char *hit = (from < end) ? matcher_find(g->m, from, end - from, &match_len) : NULL;
+        const char *ls = end, *le = end; // matching line, the end of the buffer if there is none
+        if(hit != NULL){
+            le = memchr(hit, '\n', end - hit);
+            le = (le == NULL) ? end : le + 1;
+            if(hit + match_len > le){
+                from = hit + 1; // reaches over the end of its line, not a match
+                continue;
+            }
+            ls = hit;
+            while(ls > pos && ls[-1] != '\n') ls--;
+        }
+        if(!g->invert){
+            if(hit == NULL) return 0;
+            *run_start = ls;
+            *run_end = le;
+            if(lines != NULL) *lines = 1;
+            return 1;
+        }
+        if(ls > pos){
+            *run_start = pos;
+            *run_end = ls;
+            if(lines != NULL) *lines = count_lines(pos, ls - pos);
+            return 1;
+        }
+        pos = from = le; // the line at pos matches, the run can only start after it
+    }
+    return 0;
+}
+
+/**
+ * @brief searches a buffer for lines without a match (-v)
+ * @details Only the matching lines are searched. The lines between two of them are added to the output as one range of the buffer,
+ *          so a long stretch of selected lines is written by a single entry of writev no matter how many lines it has.
+ *          The selected lines are only counted if the number is needed (-c, --stats).
+ * @param g search settings
+ * @param fout output buffer to write to
+ * @param map start of the buffer
+ * @param size size of the buffer in bytes
+ * @param count set to the number of selected lines (with -l only 0 or 1, in MODE_LINES only with --stats)
+ * @return exit status
+ */
+static int grep_inverted(const grep_opts* g, outbuf* fout, const char* map, size_t size, size_t* count){
+    stats *rec = stats_current();
+    uint64_t since = stats_match_start(rec);
+    const char *end = map + size;
+    const char *pos = map;
+    const char *run_start, *run_end;
+    size_t lines;
+    int counted = g->mode == MODE_COUNT || rec != NULL;
+
+    *count = 0;
+    while(next_selected(g, pos, end, &run_start, &run_end, counted ? &lines : NULL)){
+        pos = run_end;
+        if(g->mode == MODE_LIST){
+            *count = 1;
+            break;
+        }
+        if(counted) *count += lines;
+        if(g->mode == MODE_LINES && out_put(fout, run_start, run_end - run_start) == -1){
+            fprintf(stderr, "[%s] Error: Failed to write output\n", prog_name);
+            return 1;
+        }
+    }
+    stats_match(rec, since);
+    count_scanned(rec, map, (g->mode == MODE_LIST ? pos : end) - map, *count);
+    return 0;
+}
+
+/**
+ * @brief searches a buffer like grep_mapped and prints context lines around every run of selected lines (-A, -B, -C)
+ * @details A run is a matching line, with -v the lines between two matching lines (next_selected).
+ *          The context lines before a run are found by scanning back from its start, at most g->before lines and not before
+ *          cx->hold, and are printed together with the run as one range of the buffer. The lines after a run are
+ *          printed when the next run is found or the end of the buffer is reached. The state in cx carries over to the next
+ *          buffer of the same input (grep_stream).
+ * @param g search settings
+ * @param fout output buffer to write to
+ * @param map start of the buffer
+ * @param from offset where the search starts, the lines before are only used as context
+ * @param size size of the buffer in bytes, it ends with a complete line
+ * @param count set to the number of selected lines
+ * @param cx context state of the input
+ * @return exit status
+ */
+static int grep_context(const grep_opts* g, outbuf* fout, const char* map, size_t from, size_t size, size_t* count, context* cx){
+    stats *rec = stats_current();
+    uint64_t since = stats_match_start(rec);
+    const char *end = map + size;
+    const char *pos = map + from;
+    const char *run_start, *run_end;
+    size_t lines = 0;
+
+    *count = 0;
+    while(next_selected(g, pos, end, &run_start, &run_end, (!g->invert || rec != NULL) ? &lines : NULL)){
+        *count += lines;
+        if(print_after(fout, map, run_start - map, cx) == -1) goto fail;
+
+        size_t start = run_start - map;
+        for(size_t n = 0; n < g->before && start > cx->hold; n++){
+            start--;
+            while(start > cx->hold && map[start - 1] != '\n') start--;
+        }
+        if(cx->printed && !(cx->joined && start == cx->hold) && out_copy(fout, "--\n", 3) == -1) goto fail;
+        if(out_put(fout, map + start, run_end - map - start) == -1) goto fail;
+        cx->hold = run_end - map;
+        cx->joined = 1;
+        cx->printed = 1;
+        cx->after_left = g->after;
+        pos = run_end;
+    }
+    if(print_after(fout, map, size, cx) == -1) goto fail;
+    stats_match(rec, since);
+    count_scanned(rec, map + from, size - from, *count);
+    return 0;
+
+fail:
+    fprintf(stderr, "[%s] Error: Failed to write output\n", prog_name);
+    return 1;
+}
+
+/**
+ * @brief tests if a file looks binary: a null byte in its first BINARY_SNIFF bytes
+ * @param data start of the file
+ * @param size size of the file in bytes
+ * @return nonzero if the file looks binary
+ */
+static int looks_binary(const char* data, size_t size){
+    return memchr(data, '\0', size < BINARY_SNIFF ? size : BINARY_SNIFF) != NULL;
+}
+
+/**
+ * @brief adds the lines and matches of a searched buffer to a record (--stats)
+ * @details The lines are counted after the matcher stage, so counting them is not part of the matcher time.
+ * @param st current record, nothing is done if it is NULL
+ * @param data start of the searched lines
+ * @param size length of the searched lines in bytes, the last one may miss its newline
+ * @param count number of matching lines
+ */
+static void count_scanned(stats* st, const char* data, size_t size, size_t count){
+    if(st == NULL) return;
+    st->lines += count_lines(data, size);
+    st->matches += count;
+}
+
+/**
+ * @brief counts the lines of a buffer
+ * @param data start of a line
+ * @param size length in bytes, the last line may miss its newline
+ * @return number of lines
+ */
+static size_t count_lines(const char* data, size_t size){
+    const char *end = data + size;
+    size_t lines = 0;
+    for(const char *p = data; (p = memchr(p, '\n', end - p)) != NULL; p++) lines++;
+    if(size > 0 && end[-1] != '\n') lines++;
+    return lines;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file output.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Buffered output of mygrep.
+ * @details In fd mode every range is an entry of iov, copied data points into the staging buffer. A range that starts
+ *          where the previous one ends is merged into it, so consecutive matching lines of a mapped file become one entry.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "output.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+int out_init_fd(outbuf *o, int fd){
+    o->fd = fd;
+    o->len = 0;
+    o->niov = 0;
+    o->error = 0;
+    o->cap = OUT_STAGE;
+    o->buf = malloc(o->cap);
+    if(o->buf == NULL){
+        o->error = 1;
+        return -1;
+    }
+    return 0;
+}
+
+void out_init_mem(outbuf *o){
+    o->fd = -1;
+    o->buf = NULL;
+    o->len = 0;
+    o->cap = 0;
+    o->niov = 0;
+    o->error = 0;
+}
+
+/**
+ * @brief appends data to the growing buffer of memory mode
+ * @param o outbuf in memory mode
+ * @param data start of the range
+ * @param len length in bytes
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+static int mem_append(outbuf *o, const char *data, size_t len){
+    if(o->len + len > o->cap){
+        size_t cap = o->cap ? o->cap : 4096;
+        while(cap < o->len + len) cap *= 2;
+        char *buf = realloc(o->buf, cap);
+        if(buf == NULL){
+            o->error = 1;
+            return -1;
+        }
+        o->buf = buf;
+        o->cap = cap;
+    }
+    memcpy(o->buf + o->len, data, len);
+    o->len += len;
+    return 0;
+}
+
+int out_put(outbuf *o, const char *data, size_t len){
+    if(o->error) return -1;
+    if(len == 0) return 0;
+    if(o->fd == -1) return mem_append(o, data, len);
+
+    if(o->niov > 0){
+        struct iovec *prev = &o->iov[o->niov - 1];
+        if((const char *) prev->iov_base + prev->iov_len == data){
+            prev->iov_len += len;
+            return 0;
+        }
+    }
+    if(o->niov == OUT_IOV && out_flush(o) == -1) return -1;
+    o->iov[o->niov].iov_base = (void *) data;
+    o->iov[o->niov].iov_len = len;
+    o->niov++;
+    return 0;
+}
+
+int out_copy(outbuf *o, const char *data, size_t len){
+    if(o->error) return -1;
+    if(o->fd == -1) return mem_append(o, data, len);
+
+    if(len > o->cap - o->len && out_flush(o) == -1) return -1;
+    if(len > o->cap){
+        // does not fit into the staging buffer, written before the caller can change it
+        if(out_put(o, data, len) == -1) return -1;
+        return out_flush(o);
+    }
+    memcpy(o->buf + o->len, data, len);
+    o->len += len;
+    return out_put(o, o->buf + o->len - len, len);
+}
+
+int out_flush(outbuf *o){
+    if(o->error) return -1;
+    if(o->fd == -1) return 0;
+
+    // the time is charged to the input of the calling thread (--stats)
+    stats *st = stats_current();
+    uint64_t since = stats_clock(st);
+    unsigned calls = 0;
+    struct iovec *iov = o->iov;
+    int niov = o->niov;
+    while(niov > 0){
+        ssize_t n = writev(o->fd, iov, niov);
+        calls++;
+        if(n == -1){
+            if(errno == EINTR) continue;
+            o->error = 1;
+            stats_output(st, since, calls);
+            return -1;
+        }
+        // skip what was written, a partially written range is continued
+        while(niov > 0 && (size_t) n >= iov->iov_len){
+            n -= iov->iov_len;
+            iov++;
+            niov--;
+        }
+        if(niov > 0){
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    stats_output(st, since, calls);
+    o->niov = 0;
+    o->len = 0;
+    return 0;
+}
+
+char *out_take(outbuf *o, size_t *size){
+    char *buf = o->buf;
+    *size = o->len;
+    o->buf = NULL;
+    o->len = o->cap = 0;
+    return buf;
+}
+
+void out_free(outbuf *o){
+    free(o->buf);
+    o->buf = NULL;
+    o->len = o->cap = 0;
+    o->niov = 0;
+}
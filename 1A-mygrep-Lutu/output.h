@@ -0,0 +1,89 @@
+/**
+ * @file output.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Buffered output of mygrep.
+ * @details Matched lines are collected as a list of byte ranges and written with one writev call per batch instead of
+ *          one fprintf per line. Ranges that stay valid until the next flush (lines in a mapped file) are referenced
+ *          and not copied, all other data is copied into a fixed staging buffer.
+ *          An outbuf without file descriptor collects the output in memory, this is used by the jobs of the worker pool.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+#define OUT_IOV 256 /**< Number of byte ranges collected before they are written. */
+#define OUT_STAGE (64 << 10) /**< Size of the staging buffer for copied data (64 KiB). */
+
+/**
+ * @brief Output buffer.
+ */
+typedef struct {
+    int fd; /**< File descriptor written to, -1 if the output is collected in memory. */
+    char *buf; /**< Staging buffer (fd mode) or the collected output (memory mode). */
+    size_t len; /**< Used bytes of buf. */
+    size_t cap; /**< Size of buf. */
+    struct iovec iov[OUT_IOV]; /**< Byte ranges not written yet (fd mode). */
+    int niov; /**< Number of used entries of iov. */
+    int error; /**< Set if writing or allocating failed, every later call fails too. */
+} outbuf;
+
+/**
+ * @brief Prepares an outbuf that writes to a file descriptor.
+ * @param o outbuf to initialize
+ * @param fd file descriptor, not closed by out_free
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int out_init_fd(outbuf *o, int fd);
+
+/**
+ * @brief Prepares an outbuf that collects the output in memory.
+ * @param o outbuf to initialize
+ */
+void out_init_mem(outbuf *o);
+
+/**
+ * @brief Adds a byte range to the output without copying it.
+ * @details The range has to stay valid and unchanged until the next out_flush. In memory mode the range is copied.
+ * @param o outbuf
+ * @param data start of the range
+ * @param len length in bytes
+ * @return 0 on success, -1 on error
+ */
+int out_put(outbuf *o, const char *data, size_t len);
+
+/**
+ * @brief Adds a copy of a byte range to the output. The range may be changed after the call.
+ * @param o outbuf
+ * @param data start of the range
+ * @param len length in bytes
+ * @return 0 on success, -1 on error
+ */
+int out_copy(outbuf *o, const char *data, size_t len);
+
+/**
+ * @brief Writes all collected ranges to the file descriptor. Does nothing in memory mode.
+ * @param o outbuf
+ * @return 0 on success, -1 on error
+ */
+int out_flush(outbuf *o);
+
+/**
+ * @brief Hands over the output collected in memory mode. The outbuf is empty afterwards.
+ * @param o outbuf in memory mode
+ * @param size set to the size of the output in bytes
+ * @return the output (free with free), NULL if it is empty
+ */
+char *out_take(outbuf *o, size_t *size);
+
+/**
+ * @brief Frees the buffer of an outbuf. Data that is not flushed is lost.
+ * @param o outbuf
+ */
+void out_free(outbuf *o);
+
+#endif
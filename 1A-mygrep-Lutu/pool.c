@@ -0,0 +1,131 @@
+/**
+ * @file pool.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Worker pool that runs jobs in parallel but writes their output in job order.
+ * @details Every job writes into its own outbuf in memory mode. The calling thread merges the streams into the real output
+ *          in the order of the job indices, so the result is the same as running the jobs one after another.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "pool.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+/**
+ * @brief State of one job.
+ */
+typedef struct {
+    char *buf; /**< Output of the job (from out_take). */
+    size_t size; /**< Size of buf in bytes. */
+    int status; /**< Return value of the job. */
+    int done; /**< Set when the job is finished and buf is complete. */
+} job_slot;
+
+/**
+ * @brief State shared between the workers and the merging thread.
+ */
+typedef struct {
+    pthread_mutex_t mutex; /**< Protects everything below. */
+    pthread_cond_t cond; /**< Signaled when a job finishes or a job was written. */
+    job_slot *slots; /**< One slot per job. */
+    int njobs; /**< Number of jobs. */
+    int next; /**< Next job that is not started yet. */
+    int written; /**< Number of jobs whose output is already written. */
+    int window; /**< How far the workers may run ahead of written. */
+    pool_job job; /**< Job function. */
+    void *ctx; /**< Context for the job function. */
+} pool_state;
+
+/**
+ * @brief worker thread: takes the next job, runs it into a memory outbuf and marks it done
+ * @param arg pool_state
+ * @return NULL
+ */
+static void *worker(void *arg){
+    pool_state *p = arg;
+
+    pthread_mutex_lock(&p->mutex);
+    for(;;){
+        while(p->next < p->njobs && p->next >= p->written + p->window){
+            pthread_cond_wait(&p->cond, &p->mutex);
+        }
+        if(p->next >= p->njobs) break;
+        int index = p->next++;
+        pthread_mutex_unlock(&p->mutex);
+
+        job_slot *slot = &p->slots[index];
+        size_t size;
+        outbuf out;
+        out_init_mem(&out);
+        int status = p->job(p->ctx, index, &out);
+        if(out.error) status = 1;
+        char *buf = out_take(&out, &size);
+
+        pthread_mutex_lock(&p->mutex);
+        slot->buf = buf;
+        slot->size = size;
+        slot->status = status;
+        slot->done = 1;
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return NULL;
+}
+
+int pool_run_ordered(int njobs, int nthreads, pool_job job, void *ctx, outbuf *fout){
+    if(nthreads > njobs) nthreads = njobs;
+    if(nthreads < 1) nthreads = 1;
+
+    pool_state p;
+    p.slots = calloc(njobs > 0 ? njobs : 1, sizeof(job_slot));
+    pthread_t *threads = calloc(nthreads, sizeof(pthread_t));
+    if(p.slots == NULL || threads == NULL){
+        free(p.slots);
+        free(threads);
+        return 1;
+    }
+    pthread_mutex_init(&p.mutex, NULL);
+    pthread_cond_init(&p.cond, NULL);
+    p.njobs = njobs;
+    p.next = 0;
+    p.written = 0;
+    p.window = 2 * nthreads;
+    p.job = job;
+    p.ctx = ctx;
+
+    int started = 0;
+    for(; started < nthreads; started++){
+        if(pthread_create(&threads[started], NULL, worker, &p) != 0) break;
+    }
+
+    int ret = 0;
+    if(started == 0){
+        // no thread could be created, run everything in the calling thread
+        for(int i = 0; i < njobs; i++) ret |= job(ctx, i, fout);
+    } else {
+        for(int i = 0; i < njobs; i++){
+            pthread_mutex_lock(&p.mutex);
+            while(!p.slots[i].done) pthread_cond_wait(&p.cond, &p.mutex);
+            pthread_mutex_unlock(&p.mutex);
+
+            job_slot *slot = &p.slots[i];
+            ret |= slot->status;
+            if(out_copy(fout, slot->buf, slot->size) == -1) ret = 1;
+            free(slot->buf);
+            slot->buf = NULL;
+
+            pthread_mutex_lock(&p.mutex);
+            p.written = i + 1;
+            pthread_cond_broadcast(&p.cond);
+            pthread_mutex_unlock(&p.mutex);
+        }
+    }
+
+    for(int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    pthread_cond_destroy(&p.cond);
+    pthread_mutex_destroy(&p.mutex);
+    free(threads);
+    free(p.slots);
+    return ret;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file pool.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Worker pool that runs jobs in parallel but writes their output in job order.
+ * @details Every job writes into its own outbuf that collects the output in memory. The calling thread merges the streams into the real output
+ *          in the order of the job indices, so the result is the same as running the jobs one after another.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "output.h"
+
+/**
+ * @brief Function type of a job.
+ * @param ctx context pointer given to pool_run_ordered
+ * @param index index of the job (0 to njobs-1)
+ * @param out outbuf in memory mode the job writes its output to
+ * @return 0 on success, else error
+ */
+typedef int (*pool_job)(void *ctx, int index, outbuf *out);
+
+/**
+ * @brief Runs njobs jobs on nthreads worker threads and writes their output to fout in job order.
+ * @details Workers only start a job if it is less than 2*nthreads jobs ahead of the job currently written,
+ *          this bounds the memory used for buffered output. Output of a finished job is written as soon as all jobs before it are written.
+ * @param njobs number of jobs
+ * @param nthreads number of worker threads
+ * @param job function called for each job
+ * @param ctx context pointer passed to job
+ * @param fout outbuf the merged output is written to
+ * @return 0 if all jobs succeeded and the output could be written, else nonzero
+ */
+int pool_run_ordered(int njobs, int nthreads, pool_job job, void *ctx, outbuf *fout);
+
+#endif
@@ -0,0 +1,1049 @@
+/**
+ * @file rx.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Extended regular expressions (-E) for mygrep.
+ * @details The pattern is parsed into a syntax tree, the tree is compiled into an NFA with a continuation (every part is
+ *          compiled with the node that follows it). Input bytes are mapped to classes of bytes that no part of the pattern
+ *          can tell apart, the line start and the line end are two more symbols of the DFA.
+ *          A DFA state is the sorted set of NFA nodes that are active after a symbol. The start nodes are added after every
+ *          symbol, so a match may start anywhere in the line. A state that contains the match node ends the search of a line.
+ *          A newline feeds the line end to the current state and then continues in the state after a line start.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "rx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#define RX_MAX_NODES 100000 /**< Largest NFA, bigger expressions (large repeat counts) are rejected. */
+#define RX_DUP_MAX 255 /**< Largest count of a {m,n} repetition. */
+#define RX_MIN_LITERAL 2 /**< Shortest required literal that is used to skip lines. */
+
+#define RX_UNKNOWN (-1) /**< Transition that is not computed yet. */
+#define RX_MATCHED (-2) /**< Transition on a newline that ends a matching line. */
+
+/**
+ * @brief Types of syntax tree nodes.
+ */
+enum { A_SET, A_BOL, A_EOL, A_EMPTY, A_CAT, A_ALT, A_REP };
+
+/**
+ * @brief Node of the syntax tree. Children are indices into the node array of the parser.
+ */
+typedef struct {
+    int type; /**< one of A_* */
+    int set; /**< A_SET: index of the byte set */
+    int lit; /**< A_SET: the (folded) byte if the set stands for one literal character, else -1 */
+    int a; /**< first child (A_CAT, A_ALT, A_REP) */
+    int b; /**< second child (A_CAT, A_ALT) */
+    int min; /**< A_REP: least number of repetitions */
+    int max; /**< A_REP: largest number of repetitions, -1 for no limit */
+} rx_ast;
+
+/**
+ * @brief Types of NFA nodes.
+ */
+enum { N_SET, N_SPLIT, N_BOL, N_EOL, N_MATCH };
+
+/**
+ * @brief Node of the NFA.
+ */
+typedef struct {
+    int type; /**< one of N_* */
+    int out; /**< next node */
+    int out1; /**< N_SPLIT: second next node */
+    int set; /**< N_SET: index of the byte set */
+} rx_node;
+
+/**
+ * @brief Set of bytes, one bit per byte value.
+ */
+typedef struct {
+    uint32_t bits[8]; /**< bit b of bits[b / 32] is set if byte b is in the set */
+} rx_set;
+
+struct rx {
+    rx_node *nodes; /**< NFA */
+    int nnodes; /**< number of NFA nodes */
+    int nodes_cap; /**< allocated length of nodes */
+    rx_set *sets; /**< byte sets of the N_SET nodes */
+    int nsets; /**< number of sets */
+    int sets_cap; /**< allocated length of sets */
+    int start; /**< first NFA node */
+    int match; /**< the N_MATCH node */
+    unsigned char cls[256]; /**< byte class of every byte */
+    int nclasses; /**< number of byte classes */
+    int nsym; /**< number of DFA symbols: byte classes, line start (nclasses) and line end (nclasses + 1) */
+    int newline; /**< class of '\n', it contains no other byte */
+    unsigned char *member; /**< member[set * nclasses + c] is 1 if the bytes of class c are in the set */
+    char **lits; /**< required literals, one per alternative */
+    size_t nlits; /**< number of required literals, 0 if they are not used */
+    pthread_key_t key; /**< state cache of every thread */
+};
+
+/**
+ * @brief Lazily built DFA of one thread.
+ */
+typedef struct {
+    int nstates; /**< number of states */
+    int cap; /**< largest number of states */
+    int *delta; /**< transitions, delta[s * nsym + sym], RX_UNKNOWN if not computed yet */
+    unsigned char *accept; /**< 1 if the state contains the match node */
+    size_t *set_off; /**< start of the NFA node set of a state in pool */
+    int *set_len; /**< length of the NFA node set of a state */
+    int *pool; /**< NFA node sets of all states */
+    size_t pool_len; /**< used length of pool */
+    size_t pool_cap; /**< length of pool */
+    int *hash; /**< open addressing table from node sets to states, -1 if empty */
+    size_t hash_mask; /**< length of hash minus one, the length is a power of two */
+    int s0; /**< state before the start of a line, -1 if not built */
+    int line_start; /**< state after the start of a line, -1 if not built */
+    unsigned long flushes; /**< number of times the cache was cleared */
+    int *mark; /**< mark[node] == gen if the node is already in tmp */
+    int gen; /**< generation of mark */
+    int *stack; /**< stack of the closure computation */
+    int *tmp; /**< node set under construction */
+    int ntmp; /**< length of tmp */
+} rx_cache;
+
+/**
+ * @brief State of the parser.
+ */
+typedef struct {
+    rx *r; /**< expression the sets are added to */
+    const char *p; /**< current position in the pattern */
+    int ci; /**< nonzero if case insensitive */
+    rx_ast *ast; /**< syntax tree nodes */
+    int nast; /**< number of syntax tree nodes */
+    int ast_cap; /**< allocated length of ast */
+    const char *err; /**< error message, NULL if there is no error */
+} parser;
+
+/* ---------------------------------------------------------------- sets */
+
+/**
+ * @brief adds a byte to a set
+ * @param s set
+ * @param c byte
+ */
+static void set_add(rx_set *s, unsigned char c){
+    s->bits[c >> 5] |= 1u << (c & 31);
+}
+
+/**
+ * @brief tests if a byte is in a set
+ * @param s set
+ * @param c byte
+ * @return nonzero if c is in s
+ */
+static int set_has(const rx_set *s, unsigned char c){
+    return (s->bits[c >> 5] >> (c & 31)) & 1;
+}
+
+/**
+ * @brief adds the other case of every letter in the set
+ * @param s set
+ */
+static void set_fold(rx_set *s){
+    for(int c = 'a'; c <= 'z'; c++){
+        if(set_has(s, c) || set_has(s, c - 0x20)){
+            set_add(s, c);
+            set_add(s, c - 0x20);
+        }
+    }
+}
+
+/**
+ * @brief replaces a set by its complement. A newline is never in the result, lines do not contain it
+ * @param s set
+ */
+static void set_negate(rx_set *s){
+    for(int i = 0; i < 8; i++) s->bits[i] = ~s->bits[i];
+    s->bits['\n' >> 5] &= ~(1u << ('\n' & 31));
+}
+
+/**
+ * @brief Named character classes of bracket expressions.
+ */
+static const struct {
+    const char *name; /**< name between [: and :] */
+    int (*test)(int); /**< ctype function of the class */
+} classes[] = {
+    { "alpha", isalpha }, { "digit", isdigit }, { "alnum", isalnum }, { "upper", isupper },
+    { "lower", islower }, { "space", isspace }, { "blank", isblank }, { "punct", ispunct },
+    { "print", isprint }, { "graph", isgraph }, { "cntrl", iscntrl }, { "xdigit", isxdigit },
+};
+
+/**
+ * @brief adds all bytes of a named class to a set
+ * @param s set
+ * @param name name of the class, not null terminated
+ * @param len length of name
+ * @return 1 on success, 0 if there is no such class
+ */
+static int set_add_class(rx_set *s, const char *name, size_t len){
+    for(size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i++){
+        if(strlen(classes[i].name) == len && strncmp(classes[i].name, name, len) == 0){
+            for(int c = 0; c < 128; c++){
+                if(classes[i].test(c)) set_add(s, c);
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief appends an empty byte set to the expression
+ * @param ps parser
+ * @return index of the set, -1 if memory could not be allocated
+ */
+static int new_set(parser *ps){
+    rx *r = ps->r;
+    if(r->nsets == r->sets_cap){
+        int cap = r->sets_cap ? r->sets_cap * 2 : 16;
+        rx_set *sets = realloc(r->sets, cap * sizeof(rx_set));
+        if(sets == NULL){
+            ps->err = "Out of memory";
+            return -1;
+        }
+        r->sets = sets;
+        r->sets_cap = cap;
+    }
+    memset(&r->sets[r->nsets], 0, sizeof(rx_set));
+    return r->nsets++;
+}
+
+/* ---------------------------------------------------------------- parser */
+
+/**
+ * @brief appends a syntax tree node
+ * @param ps parser
+ * @param type node type
+ * @param a first child
+ * @param b second child
+ * @return index of the node, -1 if memory could not be allocated
+ */
+static int new_ast(parser *ps, int type, int a, int b){
+    if(ps->nast == ps->ast_cap){
+        int cap = ps->ast_cap ? ps->ast_cap * 2 : 64;
+        rx_ast *ast = realloc(ps->ast, cap * sizeof(rx_ast));
+        if(ast == NULL){
+            ps->err = "Out of memory";
+            return -1;
+        }
+        ps->ast = ast;
+        ps->ast_cap = cap;
+    }
+    rx_ast *n = &ps->ast[ps->nast];
+    n->type = type;
+    n->set = -1;
+    n->lit = -1;
+    n->a = a;
+    n->b = b;
+    n->min = n->max = 0;
+    return ps->nast++;
+}
+
+/**
+ * @brief creates a set node that matches one literal character
+ * @param ps parser
+ * @param c character
+ * @return index of the node, -1 on error
+ */
+static int parse_literal(parser *ps, unsigned char c){
+    int set = new_set(ps);
+    int n = new_ast(ps, A_SET, -1, -1);
+    if(set < 0 || n < 0) return -1;
+    set_add(&ps->r->sets[set], c);
+    if(ps->ci){
+        set_fold(&ps->r->sets[set]);
+        if(c >= 'A' && c <= 'Z') c |= 0x20;
+    }
+    ps->ast[n].set = set;
+    ps->ast[n].lit = c;
+    return n;
+}
+
+/**
+ * @brief creates a set node for an escape sequence \\w \\W \\s \\S
+ * @param ps parser
+ * @param c letter after the backslash
+ * @return index of the node, -1 on error
+ */
+static int parse_escape_class(parser *ps, char c){
+    int set = new_set(ps);
+    int n = new_ast(ps, A_SET, -1, -1);
+    if(set < 0 || n < 0) return -1;
+    rx_set *s = &ps->r->sets[set];
+    if(c == 'w' || c == 'W'){
+        set_add_class(s, "alnum", 5);
+        set_add(s, '_');
+    } else {
+        set_add_class(s, "space", 5);
+        s->bits['\n' >> 5] &= ~(1u << ('\n' & 31));
+    }
+    if(c == 'W' || c == 'S') set_negate(s);
+    ps->ast[n].set = set;
+    return n;
+}
+
+/**
+ * @brief parses a bracket expression, ps->p points to the '['
+ * @param ps parser
+ * @return index of the node, -1 on error
+ */
+static int parse_bracket(parser *ps){
+    int set = new_set(ps);
+    int n = new_ast(ps, A_SET, -1, -1);
+    if(set < 0 || n < 0) return -1;
+    rx_set *s = &ps->r->sets[set];
+    const char *p = ps->p + 1;
+
+    int negate = 0;
+    if(*p == '^'){
+        negate = 1;
+        p++;
+    }
+    for(int first = 1; ; first = 0){
+        if(*p == '\0'){
+            ps->err = "Unmatched [, [^, [:, [., or [=";
+            return -1;
+        }
+        if(*p == ']' && !first){
+            p++;
+            break;
+        }
+        if(p[0] == '[' && p[1] == ':'){
+            const char *end = strstr(p + 2, ":]");
+            if(end == NULL || !set_add_class(s, p + 2, end - (p + 2))){
+                ps->err = "Invalid character class name";
+                return -1;
+            }
+            p = end + 2;
+            continue;
+        }
+        unsigned char lo = (unsigned char) *p++;
+        if(p[0] == '-' && p[1] != ']' && p[1] != '\0'){
+            unsigned char hi = (unsigned char) p[1];
+            p += 2;
+            if(hi < lo){
+                ps->err = "Invalid range end";
+                return -1;
+            }
+            for(int c = lo; c <= hi; c++) set_add(s, c);
+        } else {
+            set_add(s, lo);
+        }
+    }
+    if(ps->ci) set_fold(s);
+    if(negate) set_negate(s);
+    ps->ast[n].set = set;
+    ps->p = p;
+    return n;
+}
+
+static int parse_alt(parser *ps);
+
+/**
+ * @brief parses an atom: group, bracket expression, '.', anchor, escape or literal
+ * @param ps parser
+ * @return index of the node, -1 on error
+ */
+static int parse_atom(parser *ps){
+    char c = *ps->p;
+    switch(c){
+        case '(': {
+            ps->p++;
+            int a = parse_alt(ps);
+            if(a < 0) return -1;
+            if(*ps->p != ')'){
+                ps->err = "Unmatched ( or \\(";
+                return -1;
+            }
+            ps->p++;
+            return a;
+        }
+        case '[':
+            return parse_bracket(ps);
+        case '.': {
+            ps->p++;
+            int set = new_set(ps);
+            int n = new_ast(ps, A_SET, -1, -1);
+            if(set < 0 || n < 0) return -1;
+            set_negate(&ps->r->sets[set]); // every byte but newline
+            ps->ast[n].set = set;
+            return n;
+        }
+        case '^':
+            ps->p++;
+            return new_ast(ps, A_BOL, -1, -1);
+        case '$':
+            ps->p++;
+            return new_ast(ps, A_EOL, -1, -1);
+        case '\\':
+            ps->p++;
+            c = *ps->p;
+            if(c == '\0'){
+                ps->err = "Trailing backslash";
+                return -1;
+            }
+            ps->p++;
+            if(c == 'w' || c == 'W' || c == 's' || c == 'S') return parse_escape_class(ps, c);
+            return parse_literal(ps, (unsigned char) c);
+        default:
+            ps->p++;
+            return parse_literal(ps, (unsigned char) c); // also '*', '+', '?' and '{' where nothing can be repeated
+    }
+}
+
+/**
+ * @brief parses a number of a {m,n} bound
+ * @param p position, moved after the digits
+ * @return the number, -1 if there are no digits, RX_DUP_MAX + 1 if it is too large
+ */
+static int parse_number(const char **p){
+    if(!isdigit((unsigned char) **p)) return -1;
+    int n = 0;
+    while(isdigit((unsigned char) **p)){
+        if(n <= RX_DUP_MAX) n = n * 10 + (**p - '0');
+        (*p)++;
+    }
+    return n > RX_DUP_MAX ? RX_DUP_MAX + 1 : n;
+}
+
+/**
+ * @brief parses a {m}, {m,}, {,n} or {m,n} bound, ps->p points to the '{'
+ * @param ps parser
+ * @param min set to the least number of repetitions
+ * @param max set to the largest number, -1 for no limit
+ * @return 1 if a bound was parsed, 0 if the '{' does not start a bound (it is a literal then), -1 on error
+ */
+static int parse_bound(parser *ps, int *min, int *max){
+    const char *p = ps->p + 1;
+    *min = parse_number(&p);
+    *max = *min;
+    if(*p == ','){
+        p++;
+        *max = parse_number(&p);
+        if(*min == -1) *min = 0;
+    } else if(*min == -1){
+        return 0;
+    }
+    if(*p != '}') return 0;
+    if(*min > RX_DUP_MAX || *max > RX_DUP_MAX){
+        ps->err = "Regular expression too big";
+        return -1;
+    }
+    if(*max != -1 && *max < *min){
+        ps->err = "Invalid content of \\{\\}";
+        return -1;
+    }
+    ps->p = p + 1;
+    return 1;
+}
+
+/**
+ * @brief parses an atom followed by any number of '*', '+', '?' and bounds
+ * @param ps parser
+ * @return index of the node, -1 on error
+ */
+static int parse_repeat(parser *ps){
+    int a = parse_atom(ps);
+    while(a >= 0){
+        int min, max;
+        char c = *ps->p;
+        if(c == '*'){
+            min = 0;
+            max = -1;
+            ps->p++;
+        } else if(c == '+'){
+            min = 1;
+            max = -1;
+            ps->p++;
+        } else if(c == '?'){
+            min = 0;
+            max = 1;
+            ps->p++;
+        } else if(c == '{'){
+            int b = parse_bound(ps, &min, &max);
+            if(b < 0) return -1;
+            if(b == 0) break;
+        } else {
+            break;
+        }
+        int n = new_ast(ps, A_REP, a, -1);
+        if(n < 0) return -1;
+        ps->ast[n].min = min;
+        ps->ast[n].max = max;
+        a = n;
+    }
+    return a;
+}
+
+/**
+ * @brief parses a concatenation, ends at '|', ')' or the end of the pattern
+ * @param ps parser
+ * @return index of the node, -1 on error
+ */
+static int parse_cat(parser *ps){
+    int left = new_ast(ps, A_EMPTY, -1, -1);
+    while(left >= 0 && *ps->p != '\0' && *ps->p != '|' && *ps->p != ')'){
+        int right = parse_repeat(ps);
+        if(right < 0) return -1;
+        left = new_ast(ps, A_CAT, left, right);
+    }
+    return left;
+}
+
+/**
+ * @brief parses alternatives separated by '|'
+ * @param ps parser
+ * @return index of the node, -1 on error
+ */
+static int parse_alt(parser *ps){
+    int left = parse_cat(ps);
+    while(left >= 0 && *ps->p == '|'){
+        ps->p++;
+        int right = parse_cat(ps);
+        if(right < 0) return -1;
+        left = new_ast(ps, A_ALT, left, right);
+    }
+    return left;
+}
+
+/* ---------------------------------------------------------------- compiler */
+
+/**
+ * @brief appends an NFA node
+ * @param ps parser (for the error message)
+ * @param type node type
+ * @param out next node
+ * @param out1 second next node of a split
+ * @param set byte set of a set node
+ * @return index of the node, -1 on error
+ */
+static int new_node(parser *ps, int type, int out, int out1, int set){
+    rx *r = ps->r;
+    if(r->nnodes == r->nodes_cap){
+        if(r->nnodes >= RX_MAX_NODES){
+            ps->err = "Regular expression too big";
+            return -1;
+        }
+        int cap = r->nodes_cap ? r->nodes_cap * 2 : 64;
+        rx_node *nodes = realloc(r->nodes, cap * sizeof(rx_node));
+        if(nodes == NULL){
+            ps->err = "Out of memory";
+            return -1;
+        }
+        r->nodes = nodes;
+        r->nodes_cap = cap;
+    }
+    rx_node *n = &r->nodes[r->nnodes];
+    n->type = type;
+    n->out = out;
+    n->out1 = out1;
+    n->set = set;
+    return r->nnodes++;
+}
+
+/**
+ * @brief compiles a syntax tree node into NFA nodes
+ * @param ps parser
+ * @param a syntax tree node
+ * @param next NFA node that follows a match of a
+ * @return first NFA node of a, -1 on error
+ */
+static int compile(parser *ps, int a, int next){
+    if(next < 0) return -1;
+    rx_ast n = ps->ast[a];
+    switch(n.type){
+        case A_SET:
+            return new_node(ps, N_SET, next, -1, n.set);
+        case A_BOL:
+            return new_node(ps, N_BOL, next, -1, -1);
+        case A_EOL:
+            return new_node(ps, N_EOL, next, -1, -1);
+        case A_CAT:
+            return compile(ps, n.a, compile(ps, n.b, next));
+        case A_ALT: {
+            int x = compile(ps, n.a, next);
+            int y = compile(ps, n.b, next);
+            if(x < 0 || y < 0) return -1;
+            return new_node(ps, N_SPLIT, x, y, -1);
+        }
+        case A_REP: {
+            int cur = next;
+            if(n.max == -1){
+                int loop = new_node(ps, N_SPLIT, -1, next, -1);
+                int body = compile(ps, n.a, loop);
+                if(body < 0) return -1;
+                ps->r->nodes[loop].out = body;
+                cur = loop;
+            } else {
+                // a{0,k} is (a(a(...)?)?)?, every split may leave to next
+                for(int i = n.min; i < n.max && cur >= 0; i++){
+                    int body = compile(ps, n.a, cur);
+                    cur = (body < 0) ? -1 : new_node(ps, N_SPLIT, body, next, -1);
+                }
+            }
+            for(int i = 0; i < n.min && cur >= 0; i++) cur = compile(ps, n.a, cur);
+            return cur;
+        }
+        default:
+            return next;
+    }
+}
+
+/**
+ * @brief computes the byte classes: two bytes are in the same class if every byte set contains both or neither
+ * @param r expression with all sets
+ */
+static void build_classes(rx *r){
+    rx_set newline;
+    memset(&newline, 0, sizeof(newline));
+    set_add(&newline, '\n');
+
+    memset(r->cls, 0, sizeof(r->cls));
+    int n = 1;
+    for(int s = 0; s <= r->nsets; s++){
+        const rx_set *set = (s < r->nsets) ? &r->sets[s] : &newline;
+        int map[512];
+        int next = 0;
+        for(int i = 0; i < 512; i++) map[i] = -1;
+        for(int c = 0; c < 256; c++){
+            int key = r->cls[c] * 2 + set_has(set, c);
+            if(map[key] < 0) map[key] = next++;
+            r->cls[c] = (unsigned char) map[key];
+        }
+        n = next;
+    }
+    r->nclasses = n;
+    r->nsym = n + 2;
+    r->newline = r->cls['\n'];
+}
+
+/**
+ * @brief finds the longest literal of a syntax tree node that every match contains, continuing the current run of literals
+ * @param ps parser
+ * @param a syntax tree node
+ * @param cur current run of literal characters
+ * @param cur_len length of the current run
+ * @param best longest run so far
+ * @param best_len length of best
+ */
+static void scan_literals(parser *ps, int a, char *cur, size_t *cur_len, char *best, size_t *best_len){
+    const rx_ast *n = &ps->ast[a];
+    switch(n->type){
+        case A_SET:
+            if(n->lit < 0 || n->lit == '\n'){
+                *cur_len = 0;
+                return;
+            }
+            cur[(*cur_len)++] = (char) n->lit;
+            if(*cur_len > *best_len){
+                memcpy(best, cur, *cur_len);
+                *best_len = *cur_len;
+            }
+            return;
+        case A_CAT:
+            scan_literals(ps, n->a, cur, cur_len, best, best_len);
+            scan_literals(ps, n->b, cur, cur_len, best, best_len);
+            return;
+        case A_BOL:
+        case A_EOL:
+        case A_EMPTY:
+            return; // match no character, the run continues
+        default:
+            *cur_len = 0; // alternatives and repetitions have no fixed text
+            return;
+    }
+}
+
+/**
+ * @brief collects the required literal of every alternative
+ * @param ps parser
+ * @param a syntax tree node
+ * @param maxlen length of the longest pattern, a literal can not be longer
+ * @return 0 on success, -1 if an alternative has no usable literal or memory could not be allocated
+ */
+static int collect_literals(parser *ps, int a, size_t maxlen){
+    rx *r = ps->r;
+    if(ps->ast[a].type == A_ALT){
+        if(collect_literals(ps, ps->ast[a].a, maxlen) == -1) return -1;
+        return collect_literals(ps, ps->ast[a].b, maxlen);
+    }
+
+    char *cur = malloc(maxlen + 1);
+    char *best = malloc(maxlen + 1);
+    char **lits = realloc(r->lits, (r->nlits + 1) * sizeof(char *));
+    if(lits != NULL) r->lits = lits;
+    size_t cur_len = 0, best_len = 0;
+    if(cur == NULL || best == NULL || lits == NULL){
+        free(cur);
+        free(best);
+        return -1;
+    }
+    scan_literals(ps, a, cur, &cur_len, best, &best_len);
+    free(cur);
+    if(best_len < RX_MIN_LITERAL){
+        free(best);
+        return -1;
+    }
+    best[best_len] = '\0';
+    r->lits[r->nlits++] = best;
+    return 0;
+}
+
+/* ---------------------------------------------------------------- lazy DFA */
+
+/**
+ * @brief frees a state cache
+ * @param arg rx_cache
+ */
+static void cache_free(void *arg){
+    rx_cache *c = arg;
+    if(c == NULL) return;
+    free(c->delta);
+    free(c->accept);
+    free(c->set_off);
+    free(c->set_len);
+    free(c->pool);
+    free(c->hash);
+    free(c->mark);
+    free(c->stack);
+    free(c->tmp);
+    free(c);
+}
+
+/**
+ * @brief removes all states of a cache
+ * @param c cache
+ */
+static void cache_clear(rx_cache *c){
+    c->nstates = 0;
+    c->pool_len = 0;
+    memset(c->hash, 0xff, (c->hash_mask + 1) * sizeof(int)); // every entry -1
+    c->s0 = c->line_start = -1;
+    c->flushes++;
+}
+
+/**
+ * @brief returns the state cache of the calling thread, creates it on the first call
+ * @details The cache is about RX_CACHE_BYTES large: half of it for the transition table, half of it for the node sets.
+ * @param r compiled expression
+ * @return cache (the program ends if memory could not be allocated)
+ */
+static rx_cache *get_cache(const rx *r){
+    rx_cache *c = pthread_getspecific(r->key);
+    if(c != NULL) return c;
+
+    c = calloc(1, sizeof(rx_cache));
+    if(c != NULL){
+        c->cap = (int) ((RX_CACHE_BYTES / 2) / (r->nsym * sizeof(int) + sizeof(size_t) + sizeof(int) + 1));
+        if(c->cap < 16) c->cap = 16;
+        c->pool_cap = (RX_CACHE_BYTES / 2) / sizeof(int);
+        if(c->pool_cap < (size_t) r->nnodes * 2) c->pool_cap = (size_t) r->nnodes * 2;
+        size_t hash_len = 1;
+        while(hash_len < (size_t) c->cap * 2) hash_len *= 2;
+        c->hash_mask = hash_len - 1;
+
+        c->delta = malloc((size_t) c->cap * r->nsym * sizeof(int));
+        c->accept = malloc(c->cap);
+        c->set_off = malloc(c->cap * sizeof(size_t));
+        c->set_len = malloc(c->cap * sizeof(int));
+        c->pool = malloc(c->pool_cap * sizeof(int));
+        c->hash = malloc(hash_len * sizeof(int));
+        c->mark = calloc(r->nnodes, sizeof(int));
+        c->stack = malloc(r->nnodes * sizeof(int));
+        c->tmp = malloc(r->nnodes * sizeof(int));
+    }
+    if(c == NULL || c->delta == NULL || c->accept == NULL || c->set_off == NULL || c->set_len == NULL || c->pool == NULL
+       || c->hash == NULL || c->mark == NULL || c->stack == NULL || c->tmp == NULL || pthread_setspecific(r->key, c) != 0){
+        // there is no way to report a failed search, without a cache the result would be wrong
+        fprintf(stderr, "Error: Out of memory for the regular expression cache\n");
+        exit(EXIT_FAILURE);
+    }
+    cache_clear(c);
+    c->flushes = 0;
+    return c;
+}
+
+/**
+ * @brief adds a node and everything reachable over splits to tmp
+ * @param r compiled expression
+ * @param c cache
+ * @param node NFA node
+ */
+static void closure(const rx *r, rx_cache *c, int node){
+    int sp = 0;
+    c->stack[sp++] = node;
+    while(sp > 0){
+        int n = c->stack[--sp];
+        if(c->mark[n] == c->gen) continue;
+        c->mark[n] = c->gen;
+        if(r->nodes[n].type == N_SPLIT){
+            c->stack[sp++] = r->nodes[n].out1;
+            c->stack[sp++] = r->nodes[n].out;
+        } else {
+            c->tmp[c->ntmp++] = n;
+        }
+    }
+}
+
+/**
+ * @brief starts a new node set in tmp
+ * @param r compiled expression
+ * @param c cache
+ */
+static void begin_set(const rx *r, rx_cache *c){
+    if(++c->gen == 0x7fffffff){
+        memset(c->mark, 0, r->nnodes * sizeof(int)); // marks are reset before the generation wraps
+        c->gen = 1;
+    }
+    c->ntmp = 0;
+}
+
+/**
+ * @brief compares two ints for qsort
+ * @param a first int
+ * @param b second int
+ * @return order
+ */
+static int cmp_int(const void *a, const void *b){
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief returns the state of the node set in tmp, adds it if it is new
+ * @details If the cache is full it is cleared first, every state id held by the caller is invalid then.
+ * @param r compiled expression
+ * @param c cache
+ * @return state id
+ */
+static int add_state(const rx *r, rx_cache *c){
+    qsort(c->tmp, c->ntmp, sizeof(int), cmp_int);
+    uint32_t h = 2166136261u;
+    for(int i = 0; i < c->ntmp; i++) h = (h ^ (uint32_t) c->tmp[i]) * 16777619u;
+
+    for(int attempt = 0; ; attempt++){
+        size_t i = h & c->hash_mask;
+        while(c->hash[i] != -1){
+            int s = c->hash[i];
+            if(c->set_len[s] == c->ntmp && memcmp(c->pool + c->set_off[s], c->tmp, c->ntmp * sizeof(int)) == 0) return s;
+            i = (i + 1) & c->hash_mask;
+        }
+        if(c->nstates < c->cap && c->pool_len + c->ntmp <= c->pool_cap){
+            int s = c->nstates++;
+            memcpy(c->pool + c->pool_len, c->tmp, c->ntmp * sizeof(int));
+            c->set_off[s] = c->pool_len;
+            c->set_len[s] = c->ntmp;
+            c->pool_len += c->ntmp;
+            c->hash[i] = s;
+            c->accept[s] = 0;
+            for(int k = 0; k < c->ntmp; k++){
+                if(c->tmp[k] == r->match) c->accept[s] = 1;
+            }
+            int *row = c->delta + (size_t) s * r->nsym;
+            for(int k = 0; k < r->nsym; k++) row[k] = RX_UNKNOWN;
+            return s;
+        }
+        cache_clear(c); // a set always fits into the empty cache, so the second attempt succeeds
+    }
+}
+
+/**
+ * @brief builds in tmp the node set that follows state s on a symbol
+ * @param r compiled expression
+ * @param c cache
+ * @param s state
+ * @param sym symbol (byte class, line start or line end)
+ */
+static void step(const rx *r, rx_cache *c, int s, int sym){
+    begin_set(r, c);
+    const int *set = c->pool + c->set_off[s];
+    int len = c->set_len[s];
+    for(int i = 0; i < len; i++){
+        const rx_node *n = &r->nodes[set[i]];
+        int hit = 0;
+        switch(n->type){
+            case N_SET: hit = sym < r->nclasses && r->member[n->set * r->nclasses + sym]; break;
+            case N_BOL: hit = (sym == r->nclasses); break;
+            case N_EOL: hit = (sym == r->nclasses + 1); break;
+        }
+        if(hit) closure(r, c, n->out);
+    }
+    if(sym != r->nclasses + 1) closure(r, c, r->start); // a match can start after every symbol
+    if(sym >= r->nclasses){
+        // anchors take no input, an anchor reached on a line start or end passes the same symbol (^^a, (^|x)(^a), a$$)
+        for(int i = 0; i < c->ntmp; i++){
+            const rx_node *n = &r->nodes[c->tmp[i]];
+            if((n->type == N_BOL && sym == r->nclasses) || (n->type == N_EOL && sym == r->nclasses + 1)) closure(r, c, n->out);
+        }
+    }
+}
+
+static int transition(const rx *r, rx_cache *c, int s, int sym);
+
+/**
+ * @brief returns the state after the start of a line
+ * @param r compiled expression
+ * @param c cache
+ * @return state id
+ */
+static int line_start(const rx *r, rx_cache *c){
+    if(c->line_start >= 0) return c->line_start;
+    if(c->s0 < 0){
+        begin_set(r, c);
+        closure(r, c, r->start);
+        c->s0 = add_state(r, c);
+    }
+    int t = c->delta[(size_t) c->s0 * r->nsym + r->nclasses];
+    if(t == RX_UNKNOWN) t = transition(r, c, c->s0, r->nclasses);
+    c->line_start = t;
+    return t;
+}
+
+/**
+ * @brief computes and stores the transition of state s on a symbol
+ * @details On a newline the line end is fed to s. If that matches the result is RX_MATCHED, else the state after the start of the next line.
+ * @param r compiled expression
+ * @param c cache
+ * @param s state
+ * @param sym symbol
+ * @return next state or RX_MATCHED. If the cache was cleared, s is not valid any more.
+ */
+static int transition(const rx *r, rx_cache *c, int s, int sym){
+    unsigned long flushes = c->flushes;
+    int t;
+    if(sym == r->newline){
+        step(r, c, s, r->nclasses + 1);
+        int matched = 0;
+        for(int i = 0; i < c->ntmp; i++){
+            if(c->tmp[i] == r->match) matched = 1;
+        }
+        t = matched ? RX_MATCHED : line_start(r, c);
+    } else {
+        step(r, c, s, sym);
+        t = add_state(r, c);
+    }
+    if(c->flushes == flushes) c->delta[(size_t) s * r->nsym + sym] = t;
+    return t;
+}
+
+/* ---------------------------------------------------------------- interface */
+
+rx *rx_compile(char *const *patterns, size_t n, int case_insensitive, const char **err){
+    rx *r = calloc(1, sizeof(rx));
+    if(r == NULL){
+        *err = "Out of memory";
+        return NULL;
+    }
+    parser ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.r = r;
+    ps.ci = case_insensitive;
+
+    int root = -1;
+    size_t maxlen = 0;
+    for(size_t i = 0; i < n && ps.err == NULL; i++){
+        ps.p = patterns[i];
+        int a = parse_alt(&ps);
+        if(a >= 0 && *ps.p == ')') ps.err = "Unmatched ) or \\)";
+        if(ps.err == NULL) root = (root < 0) ? a : new_ast(&ps, A_ALT, root, a);
+        if(strlen(patterns[i]) > maxlen) maxlen = strlen(patterns[i]);
+    }
+    if(ps.err == NULL && root < 0){
+        // no pattern: a set without bytes never matches
+        int set = new_set(&ps);
+        root = new_ast(&ps, A_SET, -1, -1);
+        if(root >= 0) ps.ast[root].set = set;
+    }
+    if(ps.err == NULL){
+        r->match = new_node(&ps, N_MATCH, -1, -1, -1);
+        r->start = compile(&ps, root, r->match);
+    }
+    if(ps.err == NULL){
+        build_classes(r);
+        r->member = malloc((size_t) (r->nsets ? r->nsets : 1) * r->nclasses);
+        if(r->member == NULL || pthread_key_create(&r->key, cache_free) != 0){
+            free(r->member);
+            r->member = NULL;
+            ps.err = "Out of memory";
+        }
+    }
+    if(ps.err != NULL){
+        *err = ps.err;
+        free(ps.ast);
+        free(r->nodes);
+        free(r->sets);
+        free(r);
+        return NULL;
+    }
+
+    unsigned char rep[256]; // one byte of every class
+    for(int c = 255; c >= 0; c--) rep[r->cls[c]] = (unsigned char) c;
+    for(int s = 0; s < r->nsets; s++){
+        for(int c = 0; c < r->nclasses; c++) r->member[s * r->nclasses + c] = (unsigned char) set_has(&r->sets[s], rep[c]);
+    }
+
+    if(collect_literals(&ps, root, maxlen) == -1){
+        for(size_t i = 0; i < r->nlits; i++) free(r->lits[i]);
+        r->nlits = 0;
+    }
+    free(ps.ast);
+    return r;
+}
+
+size_t rx_literals(const rx *r, char *const **lits){
+    *lits = r->lits;
+    return r->nlits;
+}
+
+const char *rx_find(const rx *r, const char *haystack, size_t len){
+    if(len == 0) return NULL;
+    rx_cache *c = get_cache(r);
+    int s = line_start(r, c);
+    if(c->accept[s]) return haystack; // the expression matches at the start of every line
+
+    const unsigned char *p = (const unsigned char *) haystack;
+    const unsigned char *end = p + len;
+    const unsigned char *cls = r->cls;
+    const int *delta = c->delta;
+    const int nsym = r->nsym;
+
+    for(; p < end; p++){
+        int t = delta[(size_t) s * nsym + cls[*p]];
+        if(t < 0){
+            if(t == RX_UNKNOWN) t = transition(r, c, s, cls[*p]);
+            if(t == RX_MATCHED) return (const char *) p;
+        }
+        if(c->accept[t]) return (const char *) p;
+        s = t;
+    }
+    if(end[-1] != '\n'){
+        // the last line has no newline, its end is fed here
+        int t = delta[(size_t) s * nsym + r->nclasses + 1];
+        if(t == RX_UNKNOWN) t = transition(r, c, s, r->nclasses + 1);
+        if(c->accept[t]) return (const char *) end - 1;
+    }
+    return NULL;
+}
+
+void rx_free(rx *r){
+    cache_free(pthread_getspecific(r->key));
+    pthread_setspecific(r->key, NULL);
+    pthread_key_delete(r->key);
+    for(size_t i = 0; i < r->nlits; i++) free(r->lits[i]);
+    free(r->lits);
+    free(r->member);
+    free(r->nodes);
+    free(r->sets);
+    free(r);
+}
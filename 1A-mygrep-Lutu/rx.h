@@ -0,0 +1,59 @@
+/**
+ * @file rx.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Extended regular expressions (-E) for mygrep.
+ * @details A pattern is compiled into an NFA (Thompson construction). The search runs a DFA whose states are built
+ *          lazily from the NFA while the input is read, so there is no backtracking and every input byte costs one table
+ *          lookup once its state exists. Every thread has its own state cache, it is cleared when it reaches RX_CACHE_BYTES.
+ *          Supported: literals, '.', bracket expressions with ranges and [:class:], '^', '$', groups, '|', '*', '+', '?',
+ *          {m}, {m,}, {m,n}, backslash escapes and \\w \\W \\s \\S.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef RX_H
+#define RX_H
+
+#include <stddef.h>
+
+#define RX_CACHE_BYTES (2 << 20) /**< Memory limit of the DFA state cache of one thread (2 MiB). */
+
+typedef struct rx rx;
+
+/**
+ * @brief Compiles patterns, a line matches if it matches any of them.
+ * @param patterns null terminated patterns
+ * @param n number of patterns
+ * @param case_insensitive nonzero if upper and lower case letters should not be differentiated
+ * @param err set to an error message if the compilation fails
+ * @return compiled expression, NULL on error
+ */
+rx *rx_compile(char *const *patterns, size_t n, int case_insensitive, const char **err);
+
+/**
+ * @brief Returns literal strings of which at least one occurs in every matching line.
+ * @details There is one literal for every alternative of the patterns. If an alternative has no required literal, there are none.
+ * @param r compiled expression
+ * @param lits set to the literals, they belong to r
+ * @return number of literals, 0 if no literal can be used
+ */
+size_t rx_literals(const rx *r, char *const **lits);
+
+/**
+ * @brief Searches the first line of a buffer that contains a match.
+ * @details The buffer has to start at the start of a line. Can be called by several threads at the same time.
+ * @param r compiled expression
+ * @param haystack buffer of lines, does not have to be null terminated
+ * @param len length of the buffer in bytes
+ * @return a pointer into the first matching line (the byte where the match was recognized, which may be the newline at its end), NULL if there is none
+ */
+const char *rx_find(const rx *r, const char *haystack, size_t len);
+
+/**
+ * @brief Frees a compiled expression and the state cache of the calling thread.
+ * @details Caches of other threads are freed when these threads exit, so they have to be finished before.
+ * @param r compiled expression
+ */
+void rx_free(rx *r);
+
+#endif
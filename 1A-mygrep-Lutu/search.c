@@ -0,0 +1,217 @@
+/**
+ * @file search.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Substring search engine used by mygrep.
+ * @details Every kernel compares the first and the last byte of the keyword at many positions at once and only verifies
+ *          the remaining bytes at the candidates where both match. Case insensitive search uses the same kernels, letters are
+ *          folded by setting bit 0x20 before comparing.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "search.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Folds an ascii upper case letter to lower case, every other byte stays the same.
+ */
+static const unsigned char fold_table[256] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+    0x40, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+    0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+    0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+    0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+    0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+/**
+ * @brief folds an ascii upper case letter to lower case, every other byte stays the same
+ * @param c byte
+ * @return folded byte
+ */
+static unsigned char fold(unsigned char c){
+    return fold_table[c];
+}
+
+/**
+ * @brief compares the inner bytes (without first and last) of the keyword at position p
+ * @param s prepared keyword
+ * @param p candidate position, first and last byte already match
+ * @return 1 if the keyword is at p, else 0
+ */
+static int verify(const searcher *s, const char *p){
+    if(s->len <= 2) return 1;
+    if(!s->case_insensitive) return memcmp(p + 1, s->needle + 1, s->len - 2) == 0;
+
+    for(size_t i = 1; i < s->len - 1; i++){
+        if(fold_table[(unsigned char) p[i]] != fold_table[(unsigned char) s->needle[i]]) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Horspool search kernel for case insensitive search
+ * @details The last byte of the window decides how far the window moves (skip table of searcher_init), so on average
+ *          less than one byte per position is looked at.
+ * @param s prepared keyword
+ * @param haystack buffer
+ * @param len length of the buffer
+ * @return first occurrence or NULL
+ */
+static const char *find_horspool(const searcher *s, const char *haystack, size_t len){
+    size_t n = s->len;
+    if(n == 0) return haystack;
+    if(n > len) return NULL;
+    const unsigned char *h = (const unsigned char *) haystack;
+
+    for(size_t i = 0; i <= len - n; ){
+        unsigned char c = fold_table[h[i + n - 1]];
+        if(c == s->last && fold_table[h[i]] == s->first && verify(s, haystack + i)) return haystack + i;
+        i += s->skip[c];
+    }
+    return NULL;
+}
+
+/**
+ * @brief scalar search kernel, used as fallback and for the tail of the vector kernels
+ * @details case sensitive search jumps from candidate to candidate with memchr, case insensitive search uses find_horspool.
+ * @param s prepared keyword
+ * @param haystack buffer
+ * @param len length of the buffer
+ * @return first occurrence or NULL
+ */
+static const char *find_scalar(const searcher *s, const char *haystack, size_t len){
+    if(s->case_insensitive) return find_horspool(s, haystack, len);
+
+    size_t n = s->len;
+    if(n == 0) return haystack;
+    if(n > len) return NULL;
+    const char *last = haystack + (len - n);
+    const char *p = haystack;
+    while(p <= last && (p = memchr(p, s->first, last - p + 1)) != NULL){
+        if((unsigned char) p[n - 1] == s->last && verify(s, p)) return p;
+        p++;
+    }
+    return NULL;
+}
+
+#ifdef SEARCH_X86
+/**
+ * @brief SSE2 search kernel, tests 16 positions per step
+ * @param s prepared keyword
+ * @param haystack buffer
+ * @param len length of the buffer
+ * @return first occurrence or NULL
+ */
+__attribute__((target("sse2")))
+static const char *find_sse2(const searcher *s, const char *haystack, size_t len){
+    size_t n = s->len;
+    if(n == 0) return haystack;
+    if(n > len) return NULL;
+    size_t positions = len - n + 1;
+
+    const __m128i first = _mm_set1_epi8((char) s->first);
+    const __m128i last = _mm_set1_epi8((char) s->last);
+    const __m128i first_or = _mm_set1_epi8((char) s->first_or);
+    const __m128i last_or = _mm_set1_epi8((char) s->last_or);
+
+    size_t i = 0;
+    for(; i + 16 <= positions; i += 16){
+        __m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i *) (haystack + i)), first_or);
+        __m128i b = _mm_or_si128(_mm_loadu_si128((const __m128i *) (haystack + i + n - 1)), last_or);
+        unsigned mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while(mask != 0){
+            const char *p = haystack + i + __builtin_ctz(mask);
+            if(verify(s, p)) return p;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(s, haystack + i, len - i);
+}
+
+/**
+ * @brief AVX2 search kernel, tests 32 positions per step
+ * @param s prepared keyword
+ * @param haystack buffer
+ * @param len length of the buffer
+ * @return first occurrence or NULL
+ */
+__attribute__((target("avx2")))
+static const char *find_avx2(const searcher *s, const char *haystack, size_t len){
+    size_t n = s->len;
+    if(n == 0) return haystack;
+    if(n > len) return NULL;
+    size_t positions = len - n + 1;
+
+    const __m256i first = _mm256_set1_epi8((char) s->first);
+    const __m256i last = _mm256_set1_epi8((char) s->last);
+    const __m256i first_or = _mm256_set1_epi8((char) s->first_or);
+    const __m256i last_or = _mm256_set1_epi8((char) s->last_or);
+
+    size_t i = 0;
+    for(; i + 32 <= positions; i += 32){
+        __m256i a = _mm256_or_si256(_mm256_loadu_si256((const __m256i *) (haystack + i)), first_or);
+        __m256i b = _mm256_or_si256(_mm256_loadu_si256((const __m256i *) (haystack + i + n - 1)), last_or);
+        unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while(mask != 0){
+            const char *p = haystack + i + __builtin_ctz(mask);
+            if(verify(s, p)) return p;
+            mask &= mask - 1;
+        }
+    }
+    return find_sse2(s, haystack + i, len - i);
+}
+#endif
+
+void searcher_init(searcher *s, const char *needle, int case_insensitive){
+    s->needle = needle;
+    s->len = strlen(needle);
+    s->case_insensitive = case_insensitive;
+    s->first = s->last = 0;
+    s->first_or = s->last_or = 0;
+
+    if(s->len > 0){
+        s->first = (unsigned char) needle[0];
+        s->last = (unsigned char) needle[s->len - 1];
+        if(case_insensitive){
+            // letters are compared with bit 0x20 set, this maps upper and lower case onto the same byte
+            s->first = fold(s->first);
+            s->last = fold(s->last);
+            if(s->first >= 'a' && s->first <= 'z') s->first_or = 0x20;
+            if(s->last >= 'a' && s->last <= 'z') s->last_or = 0x20;
+
+            // shift of the window if its last byte is c: distance of the last occurrence of c (without the last position) to the end
+            for(int c = 0; c < 256; c++) s->skip[c] = s->len;
+            for(size_t i = 0; i + 1 < s->len; i++) s->skip[fold_table[(unsigned char) needle[i]]] = s->len - 1 - i;
+        }
+    }
+
+    s->find = find_scalar;
+#ifdef SEARCH_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        s->find = find_avx2;
+    } else if(__builtin_cpu_supports("sse2")){
+        s->find = find_sse2;
+    }
+#endif
+}
+
+const char *searcher_find(const searcher *s, const char *haystack, size_t len){
+    return s->find(s, haystack, len);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file search.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Substring search engine used by mygrep.
+ * @details The keyword is prepared once (searcher_init), afterwards searcher_find searches it in length bounded buffers.
+ *          The search kernel (AVX2, SSE2 or scalar) is picked at runtime depending on what the cpu supports.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stddef.h>
+
+typedef struct searcher searcher;
+
+/**
+ * @brief Function pointer type of a search kernel.
+ */
+typedef const char *(*search_kernel)(const searcher *s, const char *haystack, size_t len);
+
+/**
+ * @brief Prepared keyword, created once and then used for every search.
+ */
+struct searcher {
+    const char *needle; /**< The keyword, not copied. Has to stay valid as long as the searcher is used. */
+    size_t len; /**< Length of the keyword in bytes. */
+    int case_insensitive; /**< Nonzero if upper and lower case letters are not differentiated. */
+    unsigned char first; /**< First byte of the keyword (folded to lower case if case insensitive). */
+    unsigned char last; /**< Last byte of the keyword (folded to lower case if case insensitive). */
+    unsigned char first_or; /**< 0x20 if the first byte is a letter and the search is case insensitive, else 0. Or'ed onto the input before comparing. */
+    unsigned char last_or; /**< Same as first_or for the last byte. */
+    size_t skip[256]; /**< Horspool shift for every folded byte, only set if case insensitive. */
+    search_kernel find; /**< The kernel selected by searcher_init. */
+};
+
+/**
+ * @brief Prepares a keyword for searching.
+ * @details Computes the first/last byte filters (and the Horspool skip table for case insensitive search) and selects the fastest search kernel supported by the cpu (AVX2, SSE2, scalar).
+ * @param s searcher to initialize
+ * @param needle keyword, must stay valid while s is used
+ * @param case_insensitive nonzero if the search should be case insensitive
+ */
+void searcher_init(searcher *s, const char *needle, int case_insensitive);
+
+/**
+ * @brief Searches the keyword in a buffer.
+ * @details The buffer does not have to be null terminated. An empty keyword matches at the start of the buffer.
+ * @param s prepared keyword
+ * @param haystack buffer to search in
+ * @param len length of the buffer in bytes
+ * @return pointer to the first occurrence of the keyword, NULL if there is none
+ */
+const char *searcher_find(const searcher *s, const char *haystack, size_t len);
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * @file stats.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Implementation of the counters and stage timings (--stats).
+ * @details The current record is kept per thread, so the search functions do not need an extra parameter and the jobs of the worker
+ *          pool measure into the record of their own input.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include <time.h>
+#include "stats.h"
+
+static __thread stats *current; /**< current record of the thread, NULL if nothing is measured */
+
+stats *stats_bind(stats *s){
+    stats *old = current;
+    current = s;
+    return old;
+}
+
+stats *stats_current(void){
+    return current;
+}
+
+uint64_t stats_clock(const stats *s){
+    if(s == NULL) return 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+void stats_io(stats *s, uint64_t since, unsigned calls){
+    if(s == NULL) return;
+    s->io_ns += stats_clock(s) - since;
+    s->syscalls += calls;
+}
+
+uint64_t stats_match_start(stats *s){
+    if(s == NULL) return 0;
+    s->output_mark = s->output_ns;
+    return stats_clock(s);
+}
+
+void stats_match(stats *s, uint64_t since){
+    if(s == NULL) return;
+    s->match_ns += stats_clock(s) - since - (s->output_ns - s->output_mark);
+}
+
+void stats_output(stats *s, uint64_t since, unsigned calls){
+    if(s == NULL) return;
+    s->output_ns += stats_clock(s) - since;
+    s->syscalls += calls;
+}
+
+void stats_add(stats *to, const stats *from){
+    __atomic_add_fetch(&to->bytes, from->bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&to->lines, from->lines, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&to->matches, from->matches, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&to->io_ns, from->io_ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&to->match_ns, from->match_ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&to->output_ns, from->output_ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&to->syscalls, from->syscalls, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief writes a string as JSON string literal
+ * @param out stream to write to
+ * @param str string
+ */
+static void print_string(FILE *out, const char *str){
+    fputc('"', out);
+    for(const unsigned char *c = (const unsigned char *) str; *c != '\0'; c++){
+        if(*c == '"' || *c == '\\') fprintf(out, "\\%c", *c);
+        else if(*c < 0x20) fprintf(out, "\\u%04x", *c);
+        else fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+/**
+ * @brief writes the counters of a record as JSON members
+ * @param out stream to write to
+ * @param s record
+ */
+static void print_counters(FILE *out, const stats *s){
+    fprintf(out, "\"bytes\":%llu,\"lines\":%llu,\"matches\":%llu,\"io_ns\":%llu,\"match_ns\":%llu,\"output_ns\":%llu,\"syscalls\":%llu",
+            (unsigned long long) s->bytes, (unsigned long long) s->lines, (unsigned long long) s->matches,
+            (unsigned long long) s->io_ns, (unsigned long long) s->match_ns, (unsigned long long) s->output_ns,
+            (unsigned long long) s->syscalls);
+}
+
+void stats_print(FILE *out, const stats *inputs, size_t n, const stats *other, uint64_t wall_ns){
+    stats total = *other;
+    fprintf(out, "{\"inputs\":[");
+    for(size_t i = 0; i < n; i++){
+        fprintf(out, "%s\n {\"name\":", i > 0 ? "," : "");
+        print_string(out, inputs[i].name);
+        fputc(',', out);
+        print_counters(out, &inputs[i]);
+        fputc('}', out);
+        stats_add(&total, &inputs[i]);
+    }
+    fprintf(out, "],\n \"total\":{");
+    print_counters(out, &total);
+    fprintf(out, ",\"wall_ns\":%llu}}\n", (unsigned long long) wall_ns);
+}
@@ -0,0 +1,102 @@
+/**
+ * @file stats.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Counters and stage timings of a search (--stats).
+ * @details Every thread has a current stats record the stages of the search add to: the input (open, stat, map, read), the matcher and
+ *          the output (writev). A stage takes one monotonic clock sample at its start and one at its end, so the cost is two clock reads
+ *          per read, per searched buffer and per flush, not per line. Without a current record (no --stats) nothing is measured.
+ *          System calls are counted where mygrep makes them itself, calls of helper threads (read ahead, decompression) are not included.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Counters of one input, or of everything that is not part of an input.
+ */
+typedef struct {
+    const char *name; /**< Name of the input, NULL for the record of the main thread. */
+    uint64_t bytes; /**< Bytes read or mapped. */
+    uint64_t lines; /**< Lines given to the matcher. */
+    uint64_t matches; /**< Matching lines. */
+    uint64_t io_ns; /**< Time spent opening, mapping and reading, including waits for read ahead and decompression. */
+    uint64_t match_ns; /**< Time spent searching, summed over the threads that searched chunks of the input. */
+    uint64_t output_ns; /**< Time spent writing the output. */
+    uint64_t syscalls; /**< Number of system calls. */
+    uint64_t output_mark; /**< output_ns at the start of the running matcher stage, a flush inside it is not matcher time. */
+} stats;
+
+/**
+ * @brief Makes a record the current one of the calling thread.
+ * @param s record, NULL to stop measuring
+ * @return the record that was current before
+ */
+stats *stats_bind(stats *s);
+
+/**
+ * @brief Returns the current record of the calling thread.
+ * @return record, NULL if nothing is measured
+ */
+stats *stats_current(void);
+
+/**
+ * @brief Takes a clock sample at the start of a stage.
+ * @param s current record
+ * @return monotonic time in nanoseconds, 0 if s is NULL
+ */
+uint64_t stats_clock(const stats *s);
+
+/**
+ * @brief Ends an input stage.
+ * @param s current record, nothing is done if it is NULL
+ * @param since sample from stats_clock
+ * @param calls number of system calls made in the stage
+ */
+void stats_io(stats *s, uint64_t since, unsigned calls);
+
+/**
+ * @brief Takes a clock sample at the start of a matcher stage.
+ * @param s current record
+ * @return monotonic time in nanoseconds, 0 if s is NULL
+ */
+uint64_t stats_match_start(stats *s);
+
+/**
+ * @brief Ends a matcher stage, the output written during it is not counted.
+ * @param s current record, nothing is done if it is NULL
+ * @param since sample from stats_match_start
+ */
+void stats_match(stats *s, uint64_t since);
+
+/**
+ * @brief Ends an output stage.
+ * @param s current record, nothing is done if it is NULL
+ * @param since sample from stats_clock
+ * @param calls number of system calls made in the stage
+ */
+void stats_output(stats *s, uint64_t since, unsigned calls);
+
+/**
+ * @brief Adds the counters of one record to another, atomically (records of threads that search chunks of the same input).
+ * @param to record added to
+ * @param from record that is added
+ */
+void stats_add(stats *to, const stats *from);
+
+/**
+ * @brief Writes the records as one JSON object: one entry per input and the sum of all records.
+ * @param out stream to write to
+ * @param inputs records of the inputs
+ * @param n number of inputs
+ * @param other record of the work not done for an input (output of the worker pool, last flush)
+ * @param wall_ns time from start to end of the search
+ */
+void stats_print(FILE *out, const stats *inputs, size_t n, const stats *other, uint64_t wall_ns);
+
+#endif
@@ -0,0 +1,399 @@
+/**
+ * @file walk.c
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Collects the regular files below directories (-r) with several threads.
+ * @details A directory in a queue keeps the descriptor its parent opened for it with openat, up to WALK_MAX_OPEN descriptors
+ *          in all queues. Beyond that the directory is opened again by its path when it is read.
+ *          pending counts the directories that are queued or being read. It is increased before a directory is queued,
+ *          so it only becomes 0 when the whole tree is read, then the threads stop.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#include "walk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define WALK_BUF (64 << 10) /**< Size of the getdents64 buffer of every thread (64 KiB). */
+#define WALK_MAX_OPEN 256 /**< Number of directory descriptors that may be held by the queues. */
+
+/**
+ * @brief Directory entry as returned by getdents64.
+ */
+struct walk_dirent {
+    uint64_t d_ino; /**< inode number */
+    int64_t d_off; /**< offset of the next entry */
+    unsigned short d_reclen; /**< size of this entry */
+    unsigned char d_type; /**< file type, DT_UNKNOWN if the file system does not tell */
+    char d_name[]; /**< null terminated name */
+};
+
+/**
+ * @brief A directory that is not read yet.
+ */
+typedef struct {
+    char *path; /**< path of the directory */
+    int fd; /**< descriptor opened by the parent, -1 if it has to be opened by path */
+    int root; /**< index of the path given by the user it was found under */
+} walk_dir;
+
+/**
+ * @brief A found file.
+ */
+typedef struct {
+    char *path; /**< path of the file */
+    int root; /**< index of the path given by the user it was found under */
+} walk_file;
+
+/**
+ * @brief Queue of directories and found files of one thread.
+ */
+typedef struct {
+    pthread_mutex_t mutex; /**< Protects the directories, the owner and thieves use it. */
+    walk_dir *dirs; /**< Queued directories are dirs[first] to dirs[last - 1]. */
+    size_t first; /**< Oldest directory, taken by thieves. */
+    size_t last; /**< One after the newest directory, taken by the owner. */
+    size_t cap; /**< Allocated length of dirs. */
+    walk_file *files; /**< Files found by the thread, only used by the owner. */
+    size_t nfiles; /**< Number of files. */
+    size_t files_cap; /**< Allocated length of files. */
+    char *buf; /**< getdents64 buffer. */
+} walk_queue;
+
+/**
+ * @brief State shared by all threads.
+ */
+typedef struct {
+    walk_queue *queues; /**< One queue per thread. */
+    int nqueues; /**< Number of queues. */
+    size_t pending; /**< Directories queued or being read (atomic). */
+    int open_dirs; /**< Descriptors held by queued directories (atomic). */
+    int error; /**< Set if a directory could not be read (atomic). */
+    int oom; /**< Set if memory could not be allocated (atomic). */
+} walk_state;
+
+/**
+ * @brief Argument of a walking thread.
+ */
+typedef struct {
+    walk_state *s; /**< shared state */
+    int id; /**< index of the own queue */
+} walk_worker;
+
+/**
+ * @brief queues a directory, pending has to be increased before
+ * @param q queue
+ * @param dir directory
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+static int push_dir(walk_queue *q, walk_dir dir){
+    pthread_mutex_lock(&q->mutex);
+    if(q->last == q->cap){
+        if(q->first > 0){
+            memmove(q->dirs, q->dirs + q->first, (q->last - q->first) * sizeof(walk_dir));
+            q->last -= q->first;
+            q->first = 0;
+        } else {
+            size_t cap = q->cap ? q->cap * 2 : 64;
+            walk_dir *bigger = realloc(q->dirs, cap * sizeof(walk_dir));
+            if(bigger == NULL){
+                pthread_mutex_unlock(&q->mutex);
+                return -1;
+            }
+            q->dirs = bigger;
+            q->cap = cap;
+        }
+    }
+    q->dirs[q->last++] = dir;
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+/**
+ * @brief takes a directory from a queue
+ * @param q queue
+ * @param newest nonzero for the owner (newest directory, depth first), zero for a thief (oldest directory, large subtree)
+ * @param dir set to the directory
+ * @return 1 if a directory was taken, 0 if the queue is empty
+ */
+static int take_dir(walk_queue *q, int newest, walk_dir *dir){
+    int found = 0;
+    pthread_mutex_lock(&q->mutex);
+    if(q->first < q->last){
+        *dir = newest ? q->dirs[--q->last] : q->dirs[q->first++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&q->mutex);
+    return found;
+}
+
+/**
+ * @brief adds a found file to the list of the thread
+ * @param q own queue
+ * @param path path of the file, owned by the list afterwards
+ * @param root index of the path given by the user
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+static int add_file(walk_queue *q, char *path, int root){
+    if(q->nfiles == q->files_cap){
+        size_t cap = q->files_cap ? q->files_cap * 2 : 256;
+        walk_file *bigger = realloc(q->files, cap * sizeof(walk_file));
+        if(bigger == NULL) return -1;
+        q->files = bigger;
+        q->files_cap = cap;
+    }
+    q->files[q->nfiles].path = path;
+    q->files[q->nfiles].root = root;
+    q->nfiles++;
+    return 0;
+}
+
+/**
+ * @brief builds the path of a directory entry
+ * @param dir path of the directory
+ * @param len length of dir
+ * @param name name of the entry
+ * @return allocated path, NULL if memory could not be allocated
+ */
+static char *join_path(const char *dir, size_t len, const char *name){
+    size_t name_len = strlen(name);
+    int slash = (len > 0 && dir[len - 1] != '/');
+    char *path = malloc(len + slash + name_len + 1);
+    if(path == NULL) return NULL;
+    memcpy(path, dir, len);
+    if(slash) path[len] = '/';
+    memcpy(path + len + slash, name, name_len + 1);
+    return path;
+}
+
+/**
+ * @brief reads one directory, queues its subdirectories and adds its regular files
+ * @param s shared state
+ * @param q own queue
+ * @param dir directory, its path and descriptor are released
+ */
+static void read_dir(walk_state *s, walk_queue *q, walk_dir *dir){
+    int fd = dir->fd;
+    if(fd != -1) __atomic_sub_fetch(&s->open_dirs, 1, __ATOMIC_RELAXED);
+    else fd = open(dir->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd == -1){
+        fprintf(stderr, "Error: [%s] Failed to open directory: %s\n", dir->path, strerror(errno));
+        __atomic_store_n(&s->error, 1, __ATOMIC_RELAXED);
+        free(dir->path);
+        return;
+    }
+
+    size_t len = strlen(dir->path);
+    for(;;){
+        long n = syscall(SYS_getdents64, fd, q->buf, WALK_BUF);
+        if(n == -1 && errno == EINTR) continue;
+        if(n == -1){
+            fprintf(stderr, "Error: [%s] Failed to read directory: %s\n", dir->path, strerror(errno));
+            __atomic_store_n(&s->error, 1, __ATOMIC_RELAXED);
+        }
+        if(n <= 0) break;
+
+        for(long off = 0; off < n;){
+            struct walk_dirent *e = (struct walk_dirent *) (q->buf + off);
+            off += e->d_reclen;
+            const char *name = e->d_name;
+            if(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+            unsigned char type = e->d_type;
+            if(type == DT_UNKNOWN){
+                struct stat st;
+                if(fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1) continue;
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+            if(type != DT_DIR && type != DT_REG) continue; // links, fifos, devices and sockets are skipped
+
+            char *path = join_path(dir->path, len, name);
+            if(path == NULL){
+                __atomic_store_n(&s->oom, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+            if(type == DT_REG){
+                if(add_file(q, path, dir->root) == -1){
+                    free(path);
+                    __atomic_store_n(&s->oom, 1, __ATOMIC_RELAXED);
+                }
+                continue;
+            }
+
+            walk_dir sub = { path, -1, dir->root };
+            if(__atomic_add_fetch(&s->open_dirs, 1, __ATOMIC_RELAXED) <= WALK_MAX_OPEN){
+                sub.fd = openat(fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            }
+            if(sub.fd == -1) __atomic_sub_fetch(&s->open_dirs, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&s->pending, 1, __ATOMIC_RELEASE);
+            if(push_dir(q, sub) == -1){
+                if(sub.fd != -1){
+                    close(sub.fd);
+                    __atomic_sub_fetch(&s->open_dirs, 1, __ATOMIC_RELAXED);
+                }
+                free(path);
+                __atomic_sub_fetch(&s->pending, 1, __ATOMIC_RELEASE);
+                __atomic_store_n(&s->oom, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    close(fd);
+    free(dir->path);
+}
+
+/**
+ * @brief walking thread: reads directories from the own queue or steals them until the whole tree is read
+ * @param arg walk_worker
+ * @return NULL
+ */
+static void *walk_thread(void *arg){
+    walk_worker *w = arg;
+    walk_state *s = w->s;
+    walk_queue *own = &s->queues[w->id];
+    for(;;){
+        walk_dir dir;
+        int found = take_dir(own, 1, &dir);
+        for(int i = 1; !found && i < s->nqueues; i++) found = take_dir(&s->queues[(w->id + i) % s->nqueues], 0, &dir);
+        if(found){
+            read_dir(s, own, &dir);
+            __atomic_sub_fetch(&s->pending, 1, __ATOMIC_RELEASE);
+            continue;
+        }
+        if(__atomic_load_n(&s->pending, __ATOMIC_ACQUIRE) == 0) break;
+        struct timespec pause = { 0, 50000 }; // another thread reads a directory, its subdirectories can be stolen soon
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+/**
+ * @brief orders files by the path given by the user, then by name
+ * @param a walk_file
+ * @param b walk_file
+ * @return comparison result for qsort
+ */
+static int compare_files(const void *a, const void *b){
+    const walk_file *fa = a, *fb = b;
+    if(fa->root != fb->root) return fa->root < fb->root ? -1 : 1;
+    return strcmp(fa->path, fb->path);
+}
+
+int walk_tree(char *const *roots, int nroots, int nthreads, walk_result *result){
+    result->files = NULL;
+    result->count = 0;
+    if(nthreads < 1) nthreads = 1;
+
+    walk_state s;
+    s.queues = calloc(nthreads, sizeof(walk_queue));
+    walk_worker *workers = calloc(nthreads, sizeof(walk_worker));
+    pthread_t *threads = calloc(nthreads, sizeof(pthread_t));
+    s.nqueues = nthreads;
+    s.pending = 0;
+    s.open_dirs = 0;
+    s.error = 0;
+    s.oom = (s.queues == NULL || workers == NULL || threads == NULL);
+    for(int i = 0; s.queues != NULL && i < nthreads; i++){
+        pthread_mutex_init(&s.queues[i].mutex, NULL);
+        s.queues[i].buf = malloc(WALK_BUF);
+        if(s.queues[i].buf == NULL) s.oom = 1;
+    }
+
+    // paths given by the user: directories are queued round robin, everything else is a file
+    for(int i = 0; !s.oom && i < nroots; i++){
+        struct stat st;
+        char *path = strdup(roots[i]);
+        if(path == NULL){
+            s.oom = 1;
+            break;
+        }
+        walk_queue *q = &s.queues[i % nthreads];
+        if(stat(roots[i], &st) == 0 && S_ISDIR(st.st_mode)){
+            walk_dir dir = { path, -1, i };
+            s.pending++;
+            if(push_dir(q, dir) == -1){
+                s.pending--;
+                free(path);
+                s.oom = 1;
+            }
+        } else if(add_file(q, path, i) == -1){ // the search reports a path that does not exist
+            free(path);
+            s.oom = 1;
+        }
+    }
+
+    int started = 0;
+    if(!s.oom){
+        for(; started < nthreads; started++){
+            workers[started].s = &s;
+            workers[started].id = started;
+            if(pthread_create(&threads[started], NULL, walk_thread, &workers[started]) != 0) break;
+        }
+        if(started == 0){
+            workers[0].s = &s;
+            workers[0].id = 0;
+            walk_thread(&workers[0]); // no thread could be created, the calling thread walks alone
+        }
+    }
+    for(int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+    size_t total = 0;
+    for(int i = 0; s.queues != NULL && i < nthreads; i++) total += s.queues[i].nfiles;
+    walk_file *all = malloc((total ? total : 1) * sizeof(walk_file));
+    if(all == NULL) s.oom = 1;
+
+    size_t n = 0;
+    for(int i = 0; s.queues != NULL && i < nthreads; i++){
+        walk_queue *q = &s.queues[i];
+        while(q->first < q->last){ // only left if the walk stopped early
+            walk_dir *dir = &q->dirs[q->first++];
+            if(dir->fd != -1) close(dir->fd);
+            free(dir->path);
+        }
+        for(size_t j = 0; j < q->nfiles; j++){
+            if(all != NULL) all[n++] = q->files[j];
+            else free(q->files[j].path);
+        }
+        free(q->files);
+        free(q->dirs);
+        free(q->buf);
+        pthread_mutex_destroy(&q->mutex);
+    }
+    free(s.queues);
+    free(workers);
+    free(threads);
+
+    if(all != NULL){
+        qsort(all, n, sizeof(walk_file), compare_files);
+        result->files = malloc((n ? n : 1) * sizeof(char *));
+        if(result->files == NULL){
+            s.oom = 1;
+            for(size_t j = 0; j < n; j++) free(all[j].path);
+        } else {
+            for(size_t j = 0; j < n; j++) result->files[j] = all[j].path;
+            result->count = n;
+        }
+        free(all);
+    }
+    if(s.oom){
+        walk_free(result);
+        return -1;
+    }
+    return s.error;
+}
+
+void walk_free(walk_result *result){
+    for(size_t i = 0; i < result->count; i++) free(result->files[i]);
+    free(result->files);
+    result->files = NULL;
+    result->count = 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file walk.h
+ * @author Luca, xxxxxxxx (exxxxxxxxxx@student.tuwien.ac.at)
+ * @brief Collects the regular files below directories (-r) with several threads.
+ * @details Every thread owns a queue of directories. It takes the newest directory from its own queue and puts the
+ *          subdirectories it finds back into it, an idle thread steals the oldest directory of another queue. Directories are
+ *          opened relative to their parent with openat and read with getdents64, so paths are never resolved again from the root.
+ *          Symbolic links below the given directories are not followed.
+ * @version 0.1
+ * @date 2023-10-21
+ */
+
+#ifndef WALK_H
+#define WALK_H
+
+#include <stddef.h>
+
+#define WALK_THREADS 4 /**< Number of threads if no other number is given. */
+
+/**
+ * @brief Found files, sorted by name so the result does not depend on the thread timing.
+ */
+typedef struct {
+    char **files; /**< Paths of the files, each allocated with malloc. */
+    size_t count; /**< Number of files. */
+} walk_result;
+
+/**
+ * @brief Collects the regular files below the given paths.
+ * @details A path that is not a directory is taken as it is. Directories that can not be read are reported on stderr and skipped.
+ * @param roots paths given by the user
+ * @param nroots number of paths
+ * @param nthreads number of threads
+ * @param result set to the found files
+ * @return 0 on success, 1 if a path could not be read (the other files are still in result), -1 if memory could not be allocated
+ */
+int walk_tree(char *const *roots, int nroots, int nthreads, walk_result *result);
+
+/**
+ * @brief Frees the result of walk_tree.
+ * @param result result
+ */
+void walk_free(walk_result *result);
+
+#endif
@@ -0,0 +1,626 @@
+/**
+ * @file fft.c
+ * @author Luca, xxxxxxxx (exxxxxxxx@student.tuwien.ac.at)
+ * @brief In-process Fast Fourier Transformation on a thread pool.
+ * @details For explanation of algorithm see: https://en.wikipedia.org/wiki/Cooley%E2%80%93Tukey_FFT_algorithm (data reordering, bit reversal, and in-place algorithms).
+ *          The values are kept planar (real and imaginary parts in separate arrays), so a kernel loads the parts of several
+ *          neighbouring butterflies with one vector load. The SSE2 and AVX2 kernels do the same operations in the same order as the
+ *          scalar ones, the result does not depend on the kernel that is chosen.
+ *          Large transforms use the six-step algorithm (Bailey): n = n1 * n2 values are seen as a matrix of n1 rows and n2 columns.
+ *          The columns are transformed, multiplied by twiddle factors and transposed, then the rows are transformed and the matrix is
+ *          transposed into the output. Every small transform fits into the cache, the transposes go through the matrix in tiles.
+ * @version 0.1
+ * @date 2023-11-06
+ */
+
+#include "fft.h"
+#include "pool.h"
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FFT_X86 1
+#include <immintrin.h>
+#endif
+
+#define FFT_TILE 16 /**< Rows and columns of a tile of the transposes of the six-step algorithm. */
+#define FFT_PAD 8 /**< Values between two rows of a matrix of the six-step algorithm, so the rows of a tile do not map onto the same cache sets. */
+
+/**
+ * @brief Butterfly kernels of one instruction set.
+ */
+typedef struct {
+    /**
+     * @brief butterflies k = from..to-1 of a stage with blocks of size 2h, for every block that starts below end (distance stride)
+     * @details x[k] + w^k x[k+h] and x[k] - w^k x[k+h]
+     */
+    void (*radix2)(double *re, double *im, const double *wr, const double *wi, size_t h, size_t from, size_t to, size_t stride, size_t end);
+    /**
+     * @brief two stages in one pass: blocks of size 2h with the factors w1 and then blocks of size 4h with the factors w2
+     * @details The four values k, k+h, k+2h, k+3h of a block of size 4h only depend on each other in these two stages (radix-4).
+     */
+    void (*radix4)(double *re, double *im, const double *w1r, const double *w1i, const double *w2r, const double *w2i, size_t h, size_t end);
+} kernels;
+
+/**
+ * @brief Matrices of the six-step algorithm: value j1 * n2 + j2 is in row j1 and column j2.
+ */
+typedef struct {
+    const double *in; /**< n real input values */
+    double *out; /**< n complex results, interleaved */
+    double *are; /**< real parts of the columns: n2 rows of n1 values (distance s1), each in bit reversed order before its transform */
+    double *aim; /**< imaginary parts of the columns */
+    double *bre; /**< real parts of the rows: n1 rows of n2 values (distance s2), each in bit reversed order before its transform */
+    double *bim; /**< imaginary parts of the rows */
+    const double *lo; /**< w^e for e below n1 (interleaved), w = e^(-2 pi i / n) */
+    const double *hi; /**< w^(e n1) for e below n2 (interleaved): w^e = hi[e / n1] lo[e % n1], both tables stay in the cache */
+    const size_t *rev1; /**< bit reversed index of every value of a column */
+    const size_t *rev2; /**< bit reversed index of every value of a row */
+    size_t n; /**< size of the transform */
+    size_t n1; /**< number of rows, size of a column */
+    size_t n2; /**< number of columns, size of a row */
+    size_t s1; /**< distance of the rows of are/aim */
+    size_t s2; /**< distance of the rows of bre/bim */
+    int bits1; /**< n1 = 2^bits1 */
+} sixstep;
+
+/**
+ * @brief State of one transformation, shared by all tasks.
+ */
+typedef struct {
+    double *re; /**< real parts of the n values */
+    double *im; /**< imaginary parts of the n values */
+    const double *wr; /**< real parts of the twiddle factors, the factors of blocks of size m start at m/2 - 1 (read by all threads) */
+    const double *wi; /**< imaginary parts of the twiddle factors, same layout as wr */
+    const kernels *k; /**< kernels of the cpu */
+    size_t cutoff; /**< blocks up to this size are transformed sequentially */
+    pool *p; /**< thread pool */
+    const sixstep *six; /**< matrices of the six-step algorithm, NULL for the radix-2 recursion */
+} fft_ctx;
+
+/**
+ * @brief Function that works on the rows from..to-1 of a matrix of the six-step algorithm.
+ */
+typedef void (*range_fn)(const fft_ctx *c, size_t from, size_t to);
+
+/**
+ * @brief Parameters of a task that works on a range of rows.
+ */
+typedef struct {
+    const fft_ctx *c; /**< transformation */
+    range_fn fn; /**< work of the rows */
+    size_t from; /**< first row */
+    size_t to; /**< one after the last row */
+    size_t grain; /**< ranges up to this number of rows are not split further */
+} range_args;
+
+/**
+ * @brief Parameters of a task that transforms a block.
+ */
+typedef struct {
+    const fft_ctx *c; /**< transformation */
+    size_t off; /**< first value of the block */
+    size_t m; /**< size of the block */
+} block_args;
+
+/**
+ * @brief Parameters of a task that does a part of the butterflies of the last stage of a block.
+ */
+typedef struct {
+    const fft_ctx *c; /**< transformation */
+    size_t off; /**< first value of the block */
+    size_t m; /**< size of the block */
+    size_t from; /**< first butterfly */
+    size_t to; /**< one after the last butterfly */
+} combine_args;
+
+static void transform(const fft_ctx *c, size_t off, size_t m);
+static void combine(const fft_ctx *c, size_t off, size_t m, size_t from, size_t to);
+static void for_range(const fft_ctx *c, range_fn fn, size_t from, size_t to, size_t grain);
+
+/**
+ * @brief one butterfly: x[u] + w x[v] and x[u] - w x[v]
+ * @param re real parts
+ * @param im imaginary parts
+ * @param u index of the first value
+ * @param v index of the second value
+ * @param wr real part of the twiddle factor
+ * @param wi imaginary part of the twiddle factor
+ */
+static inline void butterfly(double *re, double *im, size_t u, size_t v, double wr, double wi){
+    double tr = wr * re[v] - wi * im[v];
+    double ti = wr * im[v] + wi * re[v];
+    re[v] = re[u] - tr;
+    im[v] = im[u] - ti;
+    re[u] += tr;
+    im[u] += ti;
+}
+
+/**
+ * @brief scalar radix-2 kernel, see kernels
+ */
+static void radix2_scalar(double *re, double *im, const double *wr, const double *wi, size_t h, size_t from, size_t to, size_t stride, size_t end){
+    for(size_t k = from; k < to; k++){
+        for(size_t b = 0; b < end; b += stride) butterfly(re, im, b + k, b + k + h, wr[k], wi[k]);
+    }
+}
+
+/**
+ * @brief scalar radix-4 kernel, see kernels
+ */
+static void radix4_scalar(double *re, double *im, const double *w1r, const double *w1i, const double *w2r, const double *w2i, size_t h, size_t end){
+    for(size_t b = 0; b < end; b += 4 * h){
+        for(size_t k = 0; k < h; k++){
+            size_t a = b + k;
+            butterfly(re, im, a, a + h, w1r[k], w1i[k]);
+            butterfly(re, im, a + 2 * h, a + 3 * h, w1r[k], w1i[k]);
+            butterfly(re, im, a, a + 2 * h, w2r[k], w2i[k]);
+            butterfly(re, im, a + h, a + 3 * h, w2r[k + h], w2i[k + h]);
+        }
+    }
+}
+
+static const kernels scalar_kernels = { radix2_scalar, radix4_scalar };
+
+#ifdef FFT_X86
+/**
+ * @brief two butterflies with SSE2: x[u] + w x[v] and x[u] - w x[v] for u, u+1
+ */
+#define BUTTERFLY_SSE2(re, im, u, v, wr, wi) do { \
+        __m128d vr_ = _mm_loadu_pd((re) + (v)), vi_ = _mm_loadu_pd((im) + (v)); \
+        __m128d ur_ = _mm_loadu_pd((re) + (u)), ui_ = _mm_loadu_pd((im) + (u)); \
+        __m128d tr_ = _mm_sub_pd(_mm_mul_pd(wr, vr_), _mm_mul_pd(wi, vi_)); \
+        __m128d ti_ = _mm_add_pd(_mm_mul_pd(wr, vi_), _mm_mul_pd(wi, vr_)); \
+        _mm_storeu_pd((re) + (v), _mm_sub_pd(ur_, tr_)); \
+        _mm_storeu_pd((im) + (v), _mm_sub_pd(ui_, ti_)); \
+        _mm_storeu_pd((re) + (u), _mm_add_pd(ur_, tr_)); \
+        _mm_storeu_pd((im) + (u), _mm_add_pd(ui_, ti_)); \
+    } while(0)
+
+/**
+ * @brief four butterflies with AVX2: x[u] + w x[v] and x[u] - w x[v] for u..u+3
+ */
+#define BUTTERFLY_AVX2(re, im, u, v, wr, wi) do { \
+        __m256d vr_ = _mm256_loadu_pd((re) + (v)), vi_ = _mm256_loadu_pd((im) + (v)); \
+        __m256d ur_ = _mm256_loadu_pd((re) + (u)), ui_ = _mm256_loadu_pd((im) + (u)); \
+        __m256d tr_ = _mm256_sub_pd(_mm256_mul_pd(wr, vr_), _mm256_mul_pd(wi, vi_)); \
+        __m256d ti_ = _mm256_add_pd(_mm256_mul_pd(wr, vi_), _mm256_mul_pd(wi, vr_)); \
+        _mm256_storeu_pd((re) + (v), _mm256_sub_pd(ur_, tr_)); \
+        _mm256_storeu_pd((im) + (v), _mm256_sub_pd(ui_, ti_)); \
+        _mm256_storeu_pd((re) + (u), _mm256_add_pd(ur_, tr_)); \
+        _mm256_storeu_pd((im) + (u), _mm256_add_pd(ui_, ti_)); \
+    } while(0)
+
+/**
+ * @brief SSE2 radix-2 kernel, two butterflies per step, see kernels
+ */
+__attribute__((target("sse2")))
+static void radix2_sse2(double *re, double *im, const double *wr, const double *wi, size_t h, size_t from, size_t to, size_t stride, size_t end){
+    size_t vend = from + (to - from) / 2 * 2;
+    for(size_t b = 0; b < end; b += stride){
+        for(size_t k = from; k < vend; k += 2){
+            __m128d cr = _mm_loadu_pd(wr + k), ci = _mm_loadu_pd(wi + k);
+            BUTTERFLY_SSE2(re, im, b + k, b + k + h, cr, ci);
+        }
+    }
+    radix2_scalar(re, im, wr, wi, h, vend, to, stride, end);
+}
+
+/**
+ * @brief SSE2 radix-4 kernel, two columns per step, see kernels
+ */
+__attribute__((target("sse2")))
+static void radix4_sse2(double *re, double *im, const double *w1r, const double *w1i, const double *w2r, const double *w2i, size_t h, size_t end){
+    if(h < 2){
+        radix4_scalar(re, im, w1r, w1i, w2r, w2i, h, end);
+        return;
+    }
+    for(size_t b = 0; b < end; b += 4 * h){
+        for(size_t k = 0; k < h; k += 2){
+            size_t a = b + k;
+            __m128d c1r = _mm_loadu_pd(w1r + k), c1i = _mm_loadu_pd(w1i + k);
+            __m128d c2r = _mm_loadu_pd(w2r + k), c2i = _mm_loadu_pd(w2i + k);
+            __m128d c3r = _mm_loadu_pd(w2r + k + h), c3i = _mm_loadu_pd(w2i + k + h);
+            BUTTERFLY_SSE2(re, im, a, a + h, c1r, c1i);
+            BUTTERFLY_SSE2(re, im, a + 2 * h, a + 3 * h, c1r, c1i);
+            BUTTERFLY_SSE2(re, im, a, a + 2 * h, c2r, c2i);
+            BUTTERFLY_SSE2(re, im, a + h, a + 3 * h, c3r, c3i);
+        }
+    }
+}
+
+/**
+ * @brief AVX2 radix-2 kernel, four butterflies per step, see kernels
+ */
+__attribute__((target("avx2")))
+static void radix2_avx2(double *re, double *im, const double *wr, const double *wi, size_t h, size_t from, size_t to, size_t stride, size_t end){
+    size_t vend = from + (to - from) / 4 * 4;
+    for(size_t b = 0; b < end; b += stride){
+        for(size_t k = from; k < vend; k += 4){
+            __m256d cr = _mm256_loadu_pd(wr + k), ci = _mm256_loadu_pd(wi + k);
+            BUTTERFLY_AVX2(re, im, b + k, b + k + h, cr, ci);
+        }
+    }
+    radix2_sse2(re, im, wr, wi, h, vend, to, stride, end);
+}
+
+/**
+ * @brief AVX2 radix-4 kernel, four columns per step, see kernels
+ */
+__attribute__((target("avx2")))
+static void radix4_avx2(double *re, double *im, const double *w1r, const double *w1i, const double *w2r, const double *w2i, size_t h, size_t end){
+    if(h < 4){
+        radix4_sse2(re, im, w1r, w1i, w2r, w2i, h, end);
+        return;
+    }
+    for(size_t b = 0; b < end; b += 4 * h){
+        for(size_t k = 0; k < h; k += 4){
+            size_t a = b + k;
+            __m256d c1r = _mm256_loadu_pd(w1r + k), c1i = _mm256_loadu_pd(w1i + k);
+            __m256d c2r = _mm256_loadu_pd(w2r + k), c2i = _mm256_loadu_pd(w2i + k);
+            __m256d c3r = _mm256_loadu_pd(w2r + k + h), c3i = _mm256_loadu_pd(w2i + k + h);
+            BUTTERFLY_AVX2(re, im, a, a + h, c1r, c1i);
+            BUTTERFLY_AVX2(re, im, a + 2 * h, a + 3 * h, c1r, c1i);
+            BUTTERFLY_AVX2(re, im, a, a + 2 * h, c2r, c2i);
+            BUTTERFLY_AVX2(re, im, a + h, a + 3 * h, c3r, c3i);
+        }
+    }
+}
+
+static const kernels sse2_kernels = { radix2_sse2, radix4_sse2 };
+static const kernels avx2_kernels = { radix2_avx2, radix4_avx2 };
+#endif
+
+/**
+ * @brief chooses the kernels of the widest instruction set the cpu supports
+ * @return kernels
+ */
+static const kernels *select_kernels(void){
+#ifdef FFT_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        return &avx2_kernels;
+    } else if(__builtin_cpu_supports("sse2")){
+        return &sse2_kernels;
+    }
+#endif
+    return &scalar_kernels;
+}
+
+/**
+ * @brief job function: transforms a block
+ * @param t task, arg is block_args
+ */
+static void transform_task(pool_task *t){
+    block_args *a = t->arg;
+    transform(a->c, a->off, a->m);
+}
+
+/**
+ * @brief job function: butterflies of a block
+ * @param t task, arg is combine_args
+ */
+static void combine_task(pool_task *t){
+    combine_args *a = t->arg;
+    combine(a->c, a->off, a->m, a->from, a->to);
+}
+
+/**
+ * @brief job function: works on a range of rows
+ * @param t task, arg is range_args
+ */
+static void range_task(pool_task *t){
+    range_args *a = t->arg;
+    for_range(a->c, a->fn, a->from, a->to, a->grain);
+}
+
+/**
+ * @brief runs every stage of a block in the calling thread, two stages per pass over the block (radix-4) and a last radix-2
+ *        stage if the number of stages is odd
+ * @param c transformation, gives the kernels and twiddle factors
+ * @param re real parts of the block, in bit reversed order
+ * @param im imaginary parts of the block
+ * @param m size of the block
+ */
+static void stages(const fft_ctx *c, double *re, double *im, size_t m){
+    size_t s = 2;
+    for(; 2 * s <= m; s *= 4){
+        c->k->radix4(re, im, c->wr + s / 2 - 1, c->wi + s / 2 - 1, c->wr + s - 1, c->wi + s - 1, s / 2, m);
+    }
+    if(s <= m) c->k->radix2(re, im, c->wr + s / 2 - 1, c->wi + s / 2 - 1, s / 2, 0, s / 2, s, m);
+}
+
+/**
+ * @brief transforms a block whose values are in bit reversed order
+ * @details Small blocks are transformed by the calling thread (stages). A larger block transforms its halves in parallel and
+ *          then combines them.
+ * @param c transformation
+ * @param off first value of the block
+ * @param m size of the block
+ */
+static void transform(const fft_ctx *c, size_t off, size_t m){
+    if(m <= c->cutoff || c->p == NULL){
+        stages(c, c->re + off, c->im + off, m);
+        return;
+    }
+    block_args left = { c, off, m / 2 };
+    pool_task t;
+    pool_spawn(c->p, &t, transform_task, &left);
+    transform(c, off + m / 2, m / 2);
+    pool_join(c->p, &t);
+    combine(c, off, m, 0, m / 2);
+}
+
+/**
+ * @brief runs the butterflies from..to-1 of the last stage of a block, split into tasks of at most cutoff/2 butterflies
+ * @param c transformation
+ * @param off first value of the block
+ * @param m size of the block
+ * @param from first butterfly
+ * @param to one after the last butterfly
+ */
+static void combine(const fft_ctx *c, size_t off, size_t m, size_t from, size_t to){
+    if(to - from <= c->cutoff / 2){
+        c->k->radix2(c->re + off, c->im + off, c->wr + m / 2 - 1, c->wi + m / 2 - 1, m / 2, from, to, m, m);
+        return;
+    }
+    size_t mid = from + (to - from) / 2;
+    combine_args left = { c, off, m, from, mid };
+    pool_task t;
+    pool_spawn(c->p, &t, combine_task, &left);
+    combine(c, off, m, mid, to);
+    pool_join(c->p, &t);
+}
+
+/**
+ * @brief runs fn on the rows from..to-1, split into tasks of at least grain rows
+ * @param c transformation
+ * @param fn work of the rows
+ * @param from first row
+ * @param to one after the last row
+ * @param grain ranges up to this number of rows are run by the calling thread
+ */
+static void for_range(const fft_ctx *c, range_fn fn, size_t from, size_t to, size_t grain){
+    if(c->p == NULL || to - from <= grain){
+        fn(c, from, to);
+        return;
+    }
+    size_t mid = from + (to - from) / 2;
+    range_args left = { c, fn, from, mid, grain };
+    pool_task t;
+    pool_spawn(c->p, &t, range_task, &left);
+    for_range(c, fn, mid, to, grain);
+    pool_join(c->p, &t);
+}
+
+/**
+ * @brief six-step algorithm, steps 1 and 2: copies the columns j2 = from..to-1 of the input into rows of are/aim (in bit reversed
+ *        order) and transforms them
+ * @param c transformation
+ * @param from first column
+ * @param to one after the last column
+ */
+static void columns(const fft_ctx *c, size_t from, size_t to){
+    const sixstep *s = c->six;
+    for(size_t t = from; t < to; t += FFT_TILE){
+        size_t end = t + FFT_TILE < to ? t + FFT_TILE : to;
+        for(size_t j1 = 0; j1 < s->n1; j1++){
+            const double *x = s->in + j1 * s->n2;
+            size_t r = s->rev1[j1];
+            for(size_t j2 = t; j2 < end; j2++){
+                s->are[j2 * s->s1 + r] = x[j2];
+                s->aim[j2 * s->s1 + r] = 0.0;
+            }
+        }
+        for(size_t j2 = t; j2 < end; j2++) stages(c, s->are + j2 * s->s1, s->aim + j2 * s->s1, s->n1);
+    }
+}
+
+/**
+ * @brief six-step algorithm, steps 3 to 5: multiplies the transformed columns by w^(j2 k1), transposes them into the rows
+ *        k1 = from..to-1 of bre/bim (in bit reversed order) and transforms these rows
+ * @param c transformation
+ * @param from first row
+ * @param to one after the last row
+ */
+static void rows(const fft_ctx *c, size_t from, size_t to){
+    const sixstep *s = c->six;
+    size_t mask = s->n1 - 1;
+    for(size_t t = from; t < to; t += FFT_TILE){
+        size_t end = t + FFT_TILE < to ? t + FFT_TILE : to;
+        for(size_t j2 = 0; j2 < s->n2; j2++){
+            const double *ar = s->are + j2 * s->s1;
+            const double *ai = s->aim + j2 * s->s1;
+            size_t r = s->rev2[j2];
+            for(size_t k1 = t; k1 < end; k1++){
+                size_t e = j2 * k1; // below n
+                const double *h = s->hi + 2 * (e >> s->bits1);
+                const double *l = s->lo + 2 * (e & mask);
+                double wr = h[0] * l[0] - h[1] * l[1];
+                double wi = h[0] * l[1] + h[1] * l[0];
+                s->bre[k1 * s->s2 + r] = wr * ar[k1] - wi * ai[k1];
+                s->bim[k1 * s->s2 + r] = wr * ai[k1] + wi * ar[k1];
+            }
+        }
+        for(size_t k1 = t; k1 < end; k1++) stages(c, s->bre + k1 * s->s2, s->bim + k1 * s->s2, s->n2);
+    }
+}
+
+/**
+ * @brief six-step algorithm, step 6: transposes the rows into the results k1 + n1 k2 for k2 = from..to-1
+ * @param c transformation
+ * @param from first column of bre/bim
+ * @param to one after the last column
+ */
+static void store(const fft_ctx *c, size_t from, size_t to){
+    const sixstep *s = c->six;
+    for(size_t t = from; t < to; t += FFT_TILE){
+        size_t end = t + FFT_TILE < to ? t + FFT_TILE : to;
+        for(size_t k1 = 0; k1 < s->n1; k1++){
+            for(size_t k2 = t; k2 < end; k2++){
+                s->out[2 * (k1 + s->n1 * k2)] = s->bre[k1 * s->s2 + k2];
+                s->out[2 * (k1 + s->n1 * k2) + 1] = s->bim[k1 * s->s2 + k2];
+            }
+        }
+    }
+}
+
+/**
+ * @brief computes the twiddle factor w^k = e^(-2 pi i k / n)
+ * @param k exponent
+ * @param n size of the transform
+ * @param w set to the real and imaginary part
+ */
+static void twiddle(size_t k, size_t n, double *w){
+    if(k == 0){
+        w[0] = 1.0;
+        w[1] = 0.0;
+        return;
+    }
+    w[0] = cos(-2.0 * M_PI * (double) k / (double) n);
+    w[1] = sin(-2.0 * M_PI * (double) k / (double) n);
+}
+
+/**
+ * @brief sets the bit reversed index of every index below 2^bits
+ * @param rev 2^bits indices
+ * @param bits number of bits
+ */
+static void reverse_table(size_t *rev, int bits){
+    for(size_t i = 0; i < ((size_t) 1 << bits); i++){
+        size_t r = 0;
+        for(int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+        rev[i] = r;
+    }
+}
+
+/**
+ * @brief puts the factors of every stage with blocks up to size m one after the other, so a kernel loads neighbouring factors at once
+ * @param w twiddle factors of size n (fft_twiddles)
+ * @param n size of the transform
+ * @param m largest block, at most n
+ * @param wr set to the real parts, the factors of blocks of size s start at s/2 - 1 (m - 1 values)
+ * @param wi set to the imaginary parts
+ */
+static void stage_twiddles(const double *w, size_t n, size_t m, double *wr, double *wi){
+    for(size_t h = 1; h < m; h *= 2){
+        for(size_t k = 0; k < h; k++){
+            wr[h - 1 + k] = w[2 * k * (n / (2 * h))];
+            wi[h - 1 + k] = w[2 * k * (n / (2 * h)) + 1];
+        }
+    }
+}
+
+/**
+ * @brief transforms real input values with the six-step algorithm, see fft_real
+ * @param in n real input values
+ * @param n number of values, a power of 2 and at least 4
+ * @param out 2n doubles, set to the n complex results
+ * @param threads number of threads
+ * @param cutoff rows of at most this many values are not split among threads
+ * @return 0 on success, -1 if memory or the threads could not be allocated
+ */
+static int fft_sixstep(const double *in, size_t n, double *out, int threads, size_t cutoff){
+    int bits = 0;
+    while(((size_t) 1 << bits) < n) bits++;
+    size_t n1 = (size_t) 1 << (bits / 2);
+    size_t n2 = n / n1; // n2 >= n1
+    size_t s1 = n1 + FFT_PAD;
+    size_t s2 = n2 + FFT_PAD;
+    size_t a = n2 * s1;
+    size_t b = n1 * s2;
+
+    double *buf = malloc((2 * a + 2 * b + 4 * n2 + 2 * n1) * sizeof(double)); // both matrices, stage factors up to n2, hi and lo
+    size_t *rev = malloc((n1 + n2) * sizeof(size_t));
+    if(buf == NULL || rev == NULL){
+        free(buf);
+        free(rev);
+        return -1;
+    }
+    reverse_table(rev, bits / 2);
+    reverse_table(rev + n1, bits - bits / 2);
+    double *wr = buf + 2 * a + 2 * b;
+    double *wi = wr + n2;
+    double *hi = wi + n2;
+    double *lo = hi + 2 * n2;
+    // only O(sqrt(n)) factors: w^(e n1) = e^(-2 pi i e / n2) is the whole circle of a transform of size n2 and gives its stages
+    for(size_t e = 0; e < n2; e++) twiddle(e, n2, hi + 2 * e);
+    for(size_t e = 0; e < n1; e++) twiddle(e, n, lo + 2 * e);
+    stage_twiddles(hi, n2, n2, wr, wi);
+
+    sixstep s = { in, out, buf, buf + a, buf + 2 * a, buf + 2 * a + b, lo, hi, rev, rev + n1, n, n1, n2, s1, s2, bits / 2 };
+    fft_ctx c = { NULL, NULL, wr, wi, select_kernels(), cutoff, NULL, &s };
+    if(threads > 1){
+        c.p = pool_start(threads);
+        if(c.p == NULL){
+            free(buf);
+            free(rev);
+            return -1;
+        }
+    }
+    size_t grain1 = cutoff / n1 > FFT_TILE ? cutoff / n1 : FFT_TILE;
+    size_t grain2 = cutoff / n2 > FFT_TILE ? cutoff / n2 : FFT_TILE;
+    for_range(&c, columns, 0, n2, grain1);
+    for_range(&c, rows, 0, n1, grain2);
+    for_range(&c, store, 0, n2, grain1);
+    if(c.p != NULL) pool_stop(c.p);
+
+    free(buf);
+    free(rev);
+    return 0;
+}
+
+double *fft_twiddles(size_t n){
+    size_t h = n > 1 ? n / 2 : 1;
+    double *w = malloc(2 * h * sizeof(double));
+    if(w == NULL) return NULL;
+    for(size_t k = 0; k < h; k++) twiddle(k, n, w + 2 * k);
+    return w;
+}
+
+int fft_real(const double *in, size_t n, double *out, int threads, size_t cutoff, size_t large){
+    if(cutoff < 2) cutoff = 2;
+    if(large > 0 && n >= large && n >= 4) return fft_sixstep(in, n, out, threads, cutoff);
+
+    double *w = fft_twiddles(n);
+    double *re = malloc(4 * n * sizeof(double)); // values and twiddle factors, planar
+    if(w == NULL || re == NULL){
+        free(w);
+        free(re);
+        return -1;
+    }
+    double *im = re + n;
+    double *wr = re + 2 * n;
+    double *wi = re + 3 * n;
+
+    // bit reversed order: value i goes to the index with the bits of i in reversed order
+    int bits = 0;
+    while(((size_t) 1 << bits) < n) bits++;
+    for(size_t i = 0; i < n; i++){
+        size_t r = 0;
+        for(int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+        re[r] = in[i];
+        im[r] = 0.0;
+    }
+
+    stage_twiddles(w, n, n, wr, wi);
+    free(w);
+
+    fft_ctx c = { re, im, wr, wi, select_kernels(), cutoff, NULL, NULL };
+    if(threads > 1 && n > c.cutoff){
+        c.p = pool_start(threads);
+        if(c.p == NULL){
+            free(re);
+            return -1;
+        }
+    }
+    transform(&c, 0, n);
+    if(c.p != NULL) pool_stop(c.p);
+
+    for(size_t i = 0; i < n; i++){
+        out[2 * i] = re[i];
+        out[2 * i + 1] = im[i];
+    }
+    free(re);
+    return 0;
+}
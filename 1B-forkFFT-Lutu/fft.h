@@ -0,0 +1,44 @@
+/**
+ * @file fft.h
+ * @author Luca, xxxxxxxx (exxxxxxxx@student.tuwien.ac.at)
+ * @brief In-process Fast Fourier Transformation on a thread pool.
+ * @details Iterative radix-2 Cooley-Tukey: the input is put into bit reversed order, then every stage combines pairs of
+ *          neighbouring blocks into one block of twice the size. Blocks up to the cutoff are transformed completely by one
+ *          thread (all their stages in cache), larger blocks are split into two tasks of the work-stealing pool (pool.h) and
+ *          their combining stage is split into tasks of cutoff butterflies. The values are transformed in a planar layout with
+ *          radix-2 and radix-4 butterfly kernels for SSE2 or AVX2, chosen when the transform starts by the features of the cpu.
+ *          Transforms of at least a given size use the six-step algorithm instead: about sqrt(n) transforms of about sqrt(n) values
+ *          each (in cache), with a twiddle pass and transposes in between.
+ * @version 0.1
+ * @date 2023-11-06
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <stddef.h>
+
+#define FFT_CUTOFF 4096 /**< Default block size (complex values) below which a thread works sequentially. */
+#define FFT_LARGE 65536 /**< Default size from which on the six-step algorithm is used (the planar values no longer fit into the L2 cache). */
+
+/**
+ * @brief Computes the twiddle factors of a transform of size n: w^k = e^(-2 pi i k / n) for k = 0..n/2-1.
+ * @details The table serves every stage: the factor w_m^k of a block of size m is entry k * (n / m).
+ * @param n size of the transform, a power of 2
+ * @return n/2 complex numbers (real and imaginary part interleaved), has to be freed, NULL if memory could not be allocated
+ */
+double *fft_twiddles(size_t n);
+
+/**
+ * @brief Transforms real input values.
+ * @param in n real input values
+ * @param n number of values, a power of 2
+ * @param out 2n doubles, set to the n complex results (real and imaginary part interleaved)
+ * @param threads number of threads, 1 transforms in the calling thread
+ * @param cutoff block size below which a thread works sequentially, at least 2
+ * @param large transforms of at least this size use the six-step algorithm, 0 never
+ * @return 0 on success, -1 if memory or the threads could not be allocated
+ */
+int fft_real(const double *in, size_t n, double *out, int threads, size_t cutoff, size_t large);
+
+#endif
@@ -1,397 +1,753 @@
-/**
- * @file forkFFT.c
- * @author Luca, xxxxxxxx (exxxxxxxx@student.tuwien.ac.at)
- * @brief Implementation of the Cooley-Tukey Fast Fourier Tranformation algorithm using fork
- * @details The program implements the Cooley Tukey Fast Fourer Transformation. Input are 2^n real numbers, output are 2^n imaginary numbers.
- *          This program reads input data from stdin, performs FFT using the Cooley-Tukey algorithm on input data using a parallelized approach.
- *          It prints the result to stdout. The FFT is parallelized using fork() to create child processes.
- * @version 0.1
- * @date 2023-11-06
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <math.h>
-#include <getopt.h>
-#include <assert.h>
-#include <string.h>
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/wait.h>
-#include <sys/ioctl.h>
-
-
-static char* prog_name; /**< a char pointer to the name of the program. The name that is in the arguments at pos. 0  (argv[0]). Used for error messages */
-static double const PI = 3.141592654;  /**< Saves the value 3.141592654 to a double const variable PI. Used for calculation of FFT. */
-
-static void usage(void);
-static int forkFFT(int argP);
-static void printImaginary(double r, double i, FILE* fout, int better_acc);
-static int makeChildRun(double* start, int* pipefd1, int*pipefd2, int size);
-static double multiplyImaginaryI(double r1, double i1, double r2, double i2);
-static double multiplyImaginaryR(double r1, double i1, double r2, double i2);
-static int readSolutionFromChild(int* pipefd, double* R);
-static double roundToZero(double number, double epsilon);
-
-/**
- * @brief Main function. parses arguments etc
- * @details Start of the program. function does the argument parsing with getopt of the arguments given in argv.
- * @param argc arguments count
- * @param argv  arguments (first arg is prog name)
- * @return int
- */
-int main(int argc, char **argv){
-    int opt=0;
-    int argP=0;
-    prog_name = argv[0];
-
-    while((opt = getopt(argc, argv, "p")) != -1){
-        switch(opt){
-            case 'p':
-                argP = 1;
-                break;
-            case '?':
-                usage();
-                return EXIT_FAILURE;
-            default:
-                assert(0);
-        }
-    }
-
-    int ret = forkFFT(argP);
-    return ret;
-}
-
-/**
- * @brief prints usage to stdout
- * @details This function prints information about how to use the program, including options and arguments.
- */
-static void usage(void){
-    printf("Usage: %s [-p]\n", prog_name);
-    printf("[-p]: If option is given, the output must use exactly 3 digits after the decimal point\n");
-}
-/**
- * @brief cThis function reads input data from stdin, performs FFT using the Cooley-Tukey algorithm on input data using a parallelized approach.
- * @details For explanation of algorithm see: https://en.wikipedia.org/wiki/Cooley%E2%80%93Tukey_FFT_algorithm makes children, allocates memory, uses prog_name, uses PI, uses prog_name.
- *          It prints the result to stdout. The FFT is parallelized using fork() to create child processes
- *          for computation. The input data is expected to be in the format of real and imaginary parts
- *          interleaved, and the size of the input data should be a power of 2.
- * @param argP is argument p given or not
- * @return integer value/ return status
- */
-static int forkFFT(int argP) {
-    char *line = NULL;
-    size_t len = 0;
-    ssize_t string;
-    double *input = NULL;
-    int size = 0;
-
-    // Read input from stdin
-    while ((string = getline(&line, &len, stdin)) != -1) {
-        input = (double *) realloc(input, (size + 1) * sizeof(double));
-        if(input == NULL){
-            free(line);
-            fprintf(stderr, "[%s] Error when allocating memory for reading of input\n", prog_name);
-            return EXIT_FAILURE;
-        }
-        size++;
-        char *ptr;
-        double val = strtod(line, &ptr);
-
-        if(line == ptr || (*ptr != '\0' && *ptr != '\n')){
-            free(input);
-            free(line);
-            fprintf(stderr, "[%s] Error on strtod, received faulty input\n", prog_name);
-            return EXIT_FAILURE;
-        }
-
-        if (val == (double) -0) {
-            val = (double) 0;
-        }
-        input[size - 1] = val;
-    }
-    free(line); //line no longer needed!
-
-//freeen bei error
-    if(size > 1 && size % 2 != 0){
-        free(input);
-        fprintf(stderr, "[%s] Error: received faulty input\n", prog_name);
-        return EXIT_FAILURE;
-    }
-
-    switch(size){
-        case 0:
-            free(input);
-            fprintf(stderr, "[%s] no input given\n", prog_name);
-            return EXIT_FAILURE;
-        case 1:
-            printImaginary(input[0], (double) 0, stdout, argP); // only one input
-            free(input);
-            break;
-        default: ; // multiple inputs ; is used because: a declaration is not a statement after default switch
-            //create pipes!
-            int pipefd11[2];
-            int pipefd12[2];
-            int pipefd21[2];
-            int pipefd22[2];
-            pipe(pipefd11);
-            pipe(pipefd12);
-            pipe(pipefd21);
-            pipe(pipefd22);
-
-            if(makeChildRun(&input[0], pipefd11, pipefd12, size) != 0) {
-                free(input);
-                return EXIT_FAILURE;
-            }
-
-            if(makeChildRun(&input[1], pipefd21, pipefd22, size) != 0) {
-                free(input);
-                return EXIT_FAILURE;
-            }
-
-            // parent tasks..
-            //free mem allocated that is no longer used
-            free(input);
-
-            // here wait and read result from pipe;
-            // wait for children
-            wait(NULL);
-            wait(NULL);
-
-            double* Re = NULL;
-            double* Ro = NULL;
-            // allocate mem for result
-            Re = (double *) calloc(size, sizeof(double)); // allocate full size, because real and imaginary num is stored!
-            if(Re == NULL){
-                fprintf(stderr, "[%s] Error when allocating memory for result of children\n", prog_name);
-                return EXIT_FAILURE;
-            }
-            Ro = (double *) calloc(size, sizeof(double));
-            if(Ro == NULL){
-                free(Re);
-                fprintf(stderr, "[%s] Error when allocating memory for result of children\n", prog_name);
-                return EXIT_FAILURE;
-            }
-
-            if( (readSolutionFromChild(pipefd12, Re) != 0) || (readSolutionFromChild(pipefd22, Ro) != 0)){
-                free(Ro);
-                free(Re);
-                return EXIT_FAILURE;
-            }
-
-            // calculate result according to: Cooley-Tukey FFT
-            double *R = (double *) calloc(2*size, sizeof(double));
-            if(R == NULL){
-                free(Re);
-                free(Ro);
-                fprintf(stderr, "[%s] Error when allocating memory for result computation\n", prog_name);
-                return EXIT_FAILURE;
-            }
-
-            for (int i = 0; i < size; i+=2) {
-                R[i] = Re[i] + multiplyImaginaryR((double) cos(-2.0 * PI / size * (double)i/2), (double) sin(-2.0 * PI / (double) size * (double)i/2), Ro[i], Ro[i+1]);
-                R[i+1] = Re[i+1] + multiplyImaginaryI((double) cos(-2.0 * PI / size * (double)i/2), (double) sin(-2.0 * PI /(double) size * (double)i/2), Ro[i], Ro[i+1]);
-            }
-
-            for (int i = 0; i < size; i+=2) {
-                R[i+size] = Re[i] - multiplyImaginaryR((double) cos(-2.0 * PI / size * i/2), (double) sin(-2.0 * PI / (double) size * i/2), Ro[i], Ro[i+1]);
-                R[i+size+1] = Re[i+1] - multiplyImaginaryI((double) cos(-2.0 * PI / size * (double)i/2), (double) sin(-2.0 * PI /(double) size * (double)i/2), Ro[i], Ro[i+1]);
-            }
-
-            // print result and fix rounding errors
-            for (int i = 0; i < 2*size; i+=2) {
-                R[i] = roundToZero(R[i], 1e-3);
-                R[i+1] = roundToZero(R[i+1], 1e-3);
-                printImaginary(R[i], R[i+1], stdout, argP);
-            }
-
-            // close read end of pipes and free mem
-            close(pipefd22[0]);
-            close(pipefd12[0]);
-            free(R);
-            free(Re);
-            free(Ro);
-    }
-
-    return EXIT_SUCCESS;
-}
-
-/**
- * @brief Rounds a number to zero if it is within a specified tolerance. Also transforms -0 to 0
- * @detail This function rounds the given double precision number to zero if its absolute value
- *         is within the specified epsilon tolerance. Otherwise, it returns the original number. It is used for better calculation.
- * @param number The number to be checked and possibly rounded to zero.
- * @param epsilon he tolerance for rounding the number to zero.
- * @return transformed number
- */
-static double roundToZero(double number, double epsilon) {
-    if (number == (double) -0) {
-        number = (double) 0.0;
-    }
-    if (fabs(number) <= epsilon) {
-        return 0.0; // Return 0 if it's within the epsilon tolerance
-    } else {
-        return number; // Otherwise, return the original number
-    }
-}
-
-/**
- * @brief Reads result from the children.
- * @details This function reads the result from a child process through a pipe and inserts into the
- *          provided array 'R' the real and imaginary parts of the computed values. The data
- *          is expected to be in the format of alternating real and imaginary parts, each followed
- *          by a '*i' character. The function returns EXIT_FAILURE on failure with appropriate error messages. Uses prog_name, allocates memory.
- * @param pipefd pipefds where read end is specified
- * @param R location where doubles are stored
- * @return 0 if success, else error
- */
-static int readSolutionFromChild(int* pipefd, double* R){
-    int sizePipe = 0;
-    if(ioctl(pipefd[0], FIONREAD, &sizePipe) != 0){
-        fprintf(stderr, "[%s] Error: size of pipe is 0\n", prog_name);
-        return EXIT_FAILURE;
-    }
-    char *buffer = (char*) calloc(sizePipe+1, sizeof(char));
-    if(buffer == NULL){
-        fprintf(stderr, "[%s] Error when allocating memory for Result of Children\n", prog_name);
-        return EXIT_FAILURE;
-    }
-    char *endptr = NULL;
-    int counter = 0;
-
-    while(read(pipefd[0], buffer, sizePipe) > 0) {
-        char *str = buffer;
-        while(*str != '\0'){
-            R[counter++] = strtod(str, &endptr); // Real part
-            if(str == endptr) {
-                free(buffer);
-                fprintf(stderr, "[%s] Error on strtod, received faulty result\n", prog_name);
-                return EXIT_FAILURE;
-            }
-            str = endptr;
-            R[counter++] = strtod(str, &endptr); // Imaginary part
-
-            if(str == endptr || *endptr != '*') {
-                free(buffer);
-                fprintf(stderr, "[%s] Error on strtod, received faulty result\n", prog_name);
-                return EXIT_FAILURE;
-            }
-            str = endptr + 2; //skip the "*i" from the imaginary number
-            while(*str == ' ' || *str == '\n') { //go to next number
-                str++;
-            }
-        }
-    }
-    free(buffer);
-    return 0;
-}
-
-/**
- * @brief creates a child with fork and calls the program (recursion) with half the input. See C-T FFT
- * @details This function creates a child process using fork() and redirects the read end of pipe1 to
- *         stdin and the write end of pipe2 to stdout in the child process. It then sends the
- *         input data to the child process + closes the unused ends of the pipes. The function returns
- *         EXIT_FAILURE on failure with appropriate error messages. Uses prog_name, allocates memory.
- * @param start start of the location where the doubles of input are stored
- * @param pipefd1 Parent to Child pipe fd
- * @param pipefd2 Child to Parent pipe fd
- * @param size Size of the inputs
- * @return 0 if success, else if error
- */
-static int makeChildRun(double* start, int* pipefd1, int*pipefd2, int size){
-    int pid;
-    switch (pid = fork()){
-        case -1:
-            // exit
-            fprintf(stderr, "[%s] Error when forking children\n", prog_name);
-            return EXIT_FAILURE;
-        case 0: // child
-            //redirection of pipe1 read end to stdin and pipe2 write end to stdout.
-            close(pipefd1[1]);
-            dup2(pipefd1[0], STDIN_FILENO);
-            close(pipefd1[0]);
-
-            close(pipefd2[0]);
-            dup2(pipefd2[1], STDOUT_FILENO);
-            close(pipefd2[1]);
-
-            // call programm
-            if (execlp("./forkFFT", "forkFFT", NULL) == -1) {
-                fprintf(stderr, "[%s] Error when calling execlp. Check if path is right\n", prog_name);
-                return EXIT_FAILURE;
-            }
-        default: // parent
-            // close not used ends
-            close(pipefd1[0]);
-            close(pipefd2[1]);
-
-            char* buffer = NULL;
-            int sizeBuffer = 0;
-            int bufferOffset=0;
-            for (int i = 0; i < size; i+=2) {
-                int sizeNum =  snprintf(NULL, 0, "%.10lf\n", start[i]); // snprintf returns the size needed
-                buffer = realloc(buffer, (sizeNum + sizeBuffer + 1) * sizeof(char));
-
-                if(buffer == NULL){
-                    fprintf(stderr, "[%s] Error when reallocating memory\n", prog_name);
-                    return EXIT_FAILURE;
-                }
-                sizeBuffer += sizeNum;
-
-                int length = sprintf(buffer + bufferOffset, "%.10lf\n", start[i]);
-                if (length >= 0) {
-                    bufferOffset += length;
-                } else {
-                    free(buffer);
-                    fprintf(stderr, "[%s] Error when converting double to string\n", prog_name);
-                    return EXIT_FAILURE;
-                }
-            }
-
-            write(pipefd1[1], buffer, sizeBuffer);
-            close(pipefd1[1]);
-            free(buffer);
-            return 0;
-    }
-}
-/**
- * @brief Helper function for multiplying two imaginary numbers.
- * @details calculates the real part of a multiplication of two imaginary numbers
- * @param r1 number 1 real part
- * @param i1 number 1 imag part
- * @param r2 number 2 real part
- * @param i2 number 2 real part
- * @return real part as a double
- */
-static double multiplyImaginaryR(double r1, double i1, double r2, double i2){
-    return r1 * r2 - i1 * i2;
-}
-/**
- * @brief Helper function for multiplying two imaginary numbers.
- * @details calculates the imaginary part of a multiplication of two imaginary numbers
- * @param r1 number 1 real part (double)
- * @param i1 number 1 imag part (double)
- * @param r2 number 2 real part (double)
- * @param i2 number 2 real part (double)
- * @return imaginary part as a double
- */
-static double multiplyImaginaryI(double r1, double i1, double r2, double i2){
-    return r1 * i2 + i1 * r2;
-}
-
-/**
- * @brief Prints the Imaginary number with format: [real part] [imag part]*i to the specified output file
- * @detail This function prints a complex number with the given real and imaginary parts to the specified
- *         output file. The format of the output is determined by the 'argP' parameter - if 'argP' is non-zero,
- *         the format is "%.3lf %.3lf*i", otherwise "%.6lf %.6lf*i". it is used for the output of the FFT.
- * @param r real number (double)
- * @param i imag number (double)
- * @param fout File Pointer to out file
- * @param argP argument P: if true then 3 decimal places, else 6
- */
-static void printImaginary(double r, double i, FILE* fout, int argP){
-    if (argP)
-        fprintf(fout, "%.3lf %.3lf*i\n", r, i);
-    else
-        fprintf(fout, "%.6lf %.6lf*i\n", r, i); 
-}
+/**
+ * @file forkFFT.c
+ * @author Luca, xxxxxxxx (exxxxxxxx@student.tuwien.ac.at)
+ * @brief Implementation of the Cooley-Tukey Fast Fourier Tranformation algorithm using fork
+ * @details The program implements the Cooley Tukey Fast Fourer Transformation. Input are 2^n real numbers, output are 2^n imaginary numbers.
+ *          This program reads input data from stdin, performs FFT using the Cooley-Tukey algorithm on input data using a parallelized approach.
+ *          It prints the result to stdout. By default the FFT runs in this process on a work-stealing thread pool (fft.h),
+ *          with -f it is parallelized using fork() to create child processes like the original process tree.
+ *          With -b the process tree exchanges raw doubles with its children instead of text (bit-exact, no formatting).
+ *          The twiddle factors of the process tree are computed once by the top process and shared read-only with all children.
+ * @version 0.1
+ * @date 2023-11-06
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include "fft.h"
+
+
+static char* prog_name; /**< a char pointer to the name of the program. The name that is in the arguments at pos. 0  (argv[0]). Used for error messages */
+static const double* twiddles = NULL; /**< twiddle factors of a transform of size twiddleSize (fft_twiddles), used by the process tree */
+static int twiddleSize = 0; /**< size of the transform of the twiddle factors */
+static int twiddleFd = -1; /**< file with the twiddle factors that the children inherit (-t), -1 if they are not shared */
+static FILE* twiddleFile = NULL; /**< temporary file created by this process for twiddleFd, NULL if inherited or not shared */
+static size_t twiddleMapped = 0; /**< size of the mapping of an inherited file, 0 if twiddles is allocated */
+
+static void usage(void);
+static int forkFFT(int argP, int argF, int argB, int argX, int argT, int threads, size_t cutoff, size_t large);
+static int setupTwiddles(int fd, int size);
+static void releaseTwiddles(void);
+static int parsePositive(const char* str, long* value);
+static void printImaginary(double r, double i, FILE* fout, int better_acc);
+static int makeChildRun(double* start, int* pipefd1, int*pipefd2, int size, int binary);
+static int readTextInput(double** input, int* size);
+static int readBinaryInput(double** input, int* size);
+static int readBinaryFromChild(int* pipefd, double* R, int size);
+static int writeAll(int fd, struct iovec* iov, int iovcnt);
+static ssize_t readAll(int fd, void* buf, size_t bytes);
+static double multiplyImaginaryI(double r1, double i1, double r2, double i2);
+static double multiplyImaginaryR(double r1, double i1, double r2, double i2);
+static int readSolutionFromChild(int* pipefd, double* R);
+static double roundToZero(double number, double epsilon);
+
+/**
+ * @brief Main function. parses arguments etc
+ * @details Start of the program. function does the argument parsing with getopt of the arguments given in argv.
+ * @param argc arguments count
+ * @param argv  arguments (first arg is prog name)
+ * @return int
+ */
+int main(int argc, char **argv){
+    int opt=0;
+    int argP=0;
+    int argF=0;
+    int argB=0;
+    int argX=0;
+    long argT=-1;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long cutoff = FFT_CUTOFF;
+    long large = FFT_LARGE;
+    prog_name = argv[0];
+
+    while((opt = getopt(argc, argv, "pfbBt:j:c:l:")) != -1){
+        switch(opt){
+            case 'p':
+                argP = 1;
+                break;
+            case 'f':
+                argF = 1;
+                break;
+            case 'b':
+                argF = argB = 1;
+                break;
+            case 'B': // child of a process tree with -b: stdin and stdout carry raw doubles
+                argF = argB = argX = 1;
+                break;
+            case 't': // child of a process tree: file descriptor of the twiddle factors
+                if(parsePositive(optarg, &argT) != 0 || argT > INT_MAX){
+                    fprintf(stderr, "[%s] Error: [%s] Invalid file of twiddle factors\n", prog_name, optarg);
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'j':
+                if(parsePositive(optarg, &threads) != 0 || threads > 1024){
+                    fprintf(stderr, "[%s] Error: [%s] Invalid number of threads\n", prog_name, optarg);
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'c':
+                if(parsePositive(optarg, &cutoff) != 0 || cutoff < 2){
+                    fprintf(stderr, "[%s] Error: [%s] Invalid cutoff\n", prog_name, optarg);
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'l':
+                if(parsePositive(optarg, &large) != 0){
+                    fprintf(stderr, "[%s] Error: [%s] Invalid size for the six-step algorithm\n", prog_name, optarg);
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case '?':
+                usage();
+                return EXIT_FAILURE;
+            default:
+                assert(0);
+        }
+    }
+
+    if(threads < 1) threads = 1;
+    int ret = forkFFT(argP, argF, argB, argX, (int) argT, (int) threads, (size_t) cutoff, (size_t) large);
+    return ret;
+}
+
+/**
+ * @brief prints usage to stdout
+ * @details This function prints information about how to use the program, including options and arguments.
+ */
+static void usage(void){
+    printf("Usage: %s [-p] [-f] [-j threads] [-c cutoff] [-l large]\n", prog_name);
+    printf("[-p]: If option is given, the output must use exactly 3 digits after the decimal point\n");
+    printf("[-f]: compute the FFT with a tree of processes (fork and exec of ./forkFFT for every half) instead of threads\n");
+    printf("[-b]: like -f, but the processes exchange raw doubles instead of text (-B is used for the children)\n");
+    printf("[-t fd]: used for the children of -f and -b: file with the twiddle factors of the process tree\n");
+    printf("[-j threads]: number of threads of the in-process FFT (default: number of cpus)\n");
+    printf("[-c cutoff]: blocks of up to cutoff values are transformed by one thread without splitting them further (default %d)\n", FFT_CUTOFF);
+    printf("[-l large]: inputs of at least large values are transformed with the six-step algorithm, which works on parts that fit into the cache (default %d)\n", FFT_LARGE);
+}
+
+/**
+ * @brief parses a positive number argument
+ * @param str argument
+ * @param value set to the number
+ * @return 0 on success, -1 if str is not a positive number
+ */
+static int parsePositive(const char* str, long* value){
+    char *end;
+    errno = 0;
+    long n = strtol(str, &end, 10);
+    if(errno != 0 || end == str || *end != '\0' || n < 1) return -1;
+    *value = n;
+    return 0;
+}
+/**
+ * @brief cThis function reads input data from stdin, performs FFT using the Cooley-Tukey algorithm on input data using a parallelized approach.
+ * @details For explanation of algorithm see: https://en.wikipedia.org/wiki/Cooley%E2%80%93Tukey_FFT_algorithm makes children, allocates memory, uses prog_name, uses the twiddle factors.
+ *          It prints the result to stdout. The FFT is parallelized using fork() to create child processes
+ *          for computation. The input data is expected to be in the format of real and imaginary parts
+ *          interleaved, and the size of the input data should be a power of 2.
+ *          Without -f the FFT is computed in this process (fft_real) and no children are created.
+ * @param argP is argument p given or not
+ * @param argF is argument f given or not: process tree instead of threads
+ * @param argB is argument b given or not: the process tree exchanges raw doubles with the children
+ * @param argX is argument B given or not: this process is a child, stdin and stdout carry raw doubles
+ * @param argT argument t: inherited file with the twiddle factors, -1 if not given
+ * @param threads number of threads of the in-process FFT
+ * @param cutoff block size below which a thread of the in-process FFT works sequentially
+ * @param large input size from which on the in-process FFT uses the six-step algorithm
+ * @return integer value/ return status
+ */
+static int forkFFT(int argP, int argF, int argB, int argX, int argT, int threads, size_t cutoff, size_t large) {
+    double *input = NULL;
+    int size = 0;
+
+    if((argX ? readBinaryInput(&input, &size) : readTextInput(&input, &size)) != 0){
+        return EXIT_FAILURE;
+    }
+
+//freeen bei error
+    if(size > 1 && size % 2 != 0){
+        free(input);
+        fprintf(stderr, "[%s] Error: received faulty input\n", prog_name);
+        return EXIT_FAILURE;
+    }
+
+    if(!argF && size > 1){
+        if((size & (size - 1)) != 0){
+            free(input);
+            fprintf(stderr, "[%s] Error: received faulty input, the number of values has to be a power of 2\n", prog_name);
+            return EXIT_FAILURE;
+        }
+        double *R = (double *) malloc(2 * (size_t) size * sizeof(double));
+        if(R == NULL || fft_real(input, size, R, threads, cutoff, large) != 0){
+            free(R);
+            free(input);
+            fprintf(stderr, "[%s] Error when allocating memory for result computation\n", prog_name);
+            return EXIT_FAILURE;
+        }
+        for (int i = 0; i < 2*size; i+=2) {
+            printImaginary(roundToZero(R[i], 1e-3), roundToZero(R[i+1], 1e-3), stdout, argP);
+        }
+        free(R);
+        free(input);
+        return EXIT_SUCCESS;
+    }
+
+    if(argF && size > 1 && setupTwiddles(argT, size) != 0){
+        free(input);
+        return EXIT_FAILURE;
+    }
+
+    switch(size){
+        case 0:
+            free(input);
+            fprintf(stderr, "[%s] no input given\n", prog_name);
+            return EXIT_FAILURE;
+        case 1:
+            if(argX){
+                double R[2] = { input[0], 0.0 };
+                struct iovec iov = { R, sizeof(R) };
+                free(input);
+                if(writeAll(STDOUT_FILENO, &iov, 1) != 0){
+                    fprintf(stderr, "[%s] Error when writing result to parent\n", prog_name);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            printImaginary(input[0], (double) 0, stdout, argP); // only one input
+            free(input);
+            break;
+        default: ; // multiple inputs ; is used because: a declaration is not a statement after default switch
+            //create pipes!
+            int pipefd11[2];
+            int pipefd12[2];
+            int pipefd21[2];
+            int pipefd22[2];
+            pipe(pipefd11);
+            pipe(pipefd12);
+            pipe(pipefd21);
+            pipe(pipefd22);
+
+            if(makeChildRun(&input[0], pipefd11, pipefd12, size, argB) != 0) {
+                free(input);
+                return EXIT_FAILURE;
+            }
+
+            if(makeChildRun(&input[1], pipefd21, pipefd22, size, argB) != 0) {
+                free(input);
+                return EXIT_FAILURE;
+            }
+
+            // parent tasks..
+            //free mem allocated that is no longer used
+            free(input);
+
+            double* Re = NULL;
+            double* Ro = NULL;
+            // allocate mem for result
+            Re = (double *) calloc(size, sizeof(double)); // allocate full size, because real and imaginary num is stored!
+            if(Re == NULL){
+                fprintf(stderr, "[%s] Error when allocating memory for result of children\n", prog_name);
+                return EXIT_FAILURE;
+            }
+            Ro = (double *) calloc(size, sizeof(double));
+            if(Ro == NULL){
+                free(Re);
+                fprintf(stderr, "[%s] Error when allocating memory for result of children\n", prog_name);
+                return EXIT_FAILURE;
+            }
+
+            // read raw results before waiting: a child blocks as long as its result does not fit into the pipe
+            if(argB && ((readBinaryFromChild(pipefd12, Re, size) != 0) || (readBinaryFromChild(pipefd22, Ro, size) != 0))){
+                free(Ro);
+                free(Re);
+                return EXIT_FAILURE;
+            }
+
+            // here wait and read result from pipe;
+            // wait for children
+            wait(NULL);
+            wait(NULL);
+
+            if(!argB && ((readSolutionFromChild(pipefd12, Re) != 0) || (readSolutionFromChild(pipefd22, Ro) != 0))){
+                free(Ro);
+                free(Re);
+                return EXIT_FAILURE;
+            }
+
+            // calculate result according to: Cooley-Tukey FFT
+            double *R = (double *) calloc(2*size, sizeof(double));
+            if(R == NULL){
+                free(Re);
+                free(Ro);
+                fprintf(stderr, "[%s] Error when allocating memory for result computation\n", prog_name);
+                return EXIT_FAILURE;
+            }
+
+            // twiddle factor k of this size is entry k * step of the table, both halves use the same product
+            int step = twiddleSize / size;
+            for (int i = 0; i < size; i+=2) {
+                double wr = twiddles[i * step];
+                double wi = twiddles[i * step + 1];
+                double tr = multiplyImaginaryR(wr, wi, Ro[i], Ro[i+1]);
+                double ti = multiplyImaginaryI(wr, wi, Ro[i], Ro[i+1]);
+                R[i] = Re[i] + tr;
+                R[i+1] = Re[i+1] + ti;
+                R[i+size] = Re[i] - tr;
+                R[i+size+1] = Re[i+1] - ti;
+            }
+
+            if(argX){ // unrounded to the parent
+                struct iovec iov = { R, 2 * (size_t) size * sizeof(double) };
+                if(writeAll(STDOUT_FILENO, &iov, 1) != 0){
+                    close(pipefd22[0]);
+                    close(pipefd12[0]);
+                    free(R);
+                    free(Re);
+                    free(Ro);
+                    fprintf(stderr, "[%s] Error when writing result to parent\n", prog_name);
+                    return EXIT_FAILURE;
+                }
+            }
+
+            // print result and fix rounding errors
+            for (int i = 0; !argX && i < 2*size; i+=2) {
+                R[i] = roundToZero(R[i], 1e-3);
+                R[i+1] = roundToZero(R[i+1], 1e-3);
+                printImaginary(R[i], R[i+1], stdout, argP);
+            }
+
+            // close read end of pipes and free mem
+            close(pipefd22[0]);
+            close(pipefd12[0]);
+            free(R);
+            free(Re);
+            free(Ro);
+            releaseTwiddles();
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief reads the input values from stdin, one number per line
+ * @details Uses prog_name, allocates memory.
+ * @param result set to the values, has to be freed by the caller
+ * @param count set to the number of values
+ * @return 0 if success, else error
+ */
+static int readTextInput(double** result, int* count) {
+    char *line = NULL;
+    size_t len = 0;
+    ssize_t string;
+    double *input = NULL;
+    int size = 0;
+    int capacity = 0;
+
+    // Read input from stdin
+    while ((string = getline(&line, &len, stdin)) != -1) {
+        if(size == capacity){
+            capacity = capacity ? 2 * capacity : 64; // grows geometrically, large inputs are not copied for every line
+            double *bigger = (double *) realloc(input, capacity * sizeof(double));
+            if(bigger == NULL){
+                free(input);
+                free(line);
+                fprintf(stderr, "[%s] Error when allocating memory for reading of input\n", prog_name);
+                return -1;
+            }
+            input = bigger;
+        }
+        size++;
+        char *ptr;
+        double val = strtod(line, &ptr);
+
+        if(line == ptr || (*ptr != '\0' && *ptr != '\n')){
+            free(input);
+            free(line);
+            fprintf(stderr, "[%s] Error on strtod, received faulty input\n", prog_name);
+            return -1;
+        }
+
+        if (val == (double) -0) {
+            val = (double) 0;
+        }
+        input[size - 1] = val;
+    }
+    free(line); //line no longer needed!
+
+    *result = input;
+    *count = size;
+    return 0;
+}
+
+/**
+ * @brief reads the input values of a child of a process tree with -b from stdin
+ * @details The parent sends the number of values (size_t) followed by the raw doubles. Uses prog_name, allocates memory.
+ * @param input set to the values, has to be freed by the caller
+ * @param size set to the number of values
+ * @return 0 if success, else error
+ */
+static int readBinaryInput(double** input, int* size){
+    size_t n = 0;
+    if(readAll(STDIN_FILENO, &n, sizeof(n)) != (ssize_t) sizeof(n) || n == 0 || n > INT_MAX){
+        fprintf(stderr, "[%s] Error: received faulty input from parent\n", prog_name);
+        return -1;
+    }
+    *input = (double *) malloc(n * sizeof(double));
+    if(*input == NULL){
+        fprintf(stderr, "[%s] Error when allocating memory for reading of input\n", prog_name);
+        return -1;
+    }
+    if(readAll(STDIN_FILENO, *input, n * sizeof(double)) != (ssize_t) (n * sizeof(double))){
+        free(*input);
+        fprintf(stderr, "[%s] Error: received faulty input from parent\n", prog_name);
+        return -1;
+    }
+    *size = (int) n;
+    return 0;
+}
+
+/**
+ * @brief provides the twiddle factors of the process tree
+ * @details The top process computes the factors of its size once (fft_twiddles, full precision pi) and writes them into an unlinked
+ *          temporary file. The children inherit the file (-t) and map it read-only, a process of size m uses every (N/m)th entry.
+ *          If the file can not be created or mapped, the process computes the factors of its own size. Uses prog_name, allocates memory.
+ * @param fd inherited file with the twiddle factors, -1 if none
+ * @param size size of the inputs of this process, a power of 2
+ * @return 0 if success, else error
+ */
+static int setupTwiddles(int fd, int size){
+    struct stat st;
+    if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size % sizeof(double) == 0){
+        size_t n = st.st_size / sizeof(double); // n/2 complex numbers of a transform of size n
+        if(n >= (size_t) size && n <= INT_MAX && n % size == 0){
+            void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if(map != MAP_FAILED){
+                twiddles = map;
+                twiddleSize = (int) n;
+                twiddleMapped = st.st_size;
+                twiddleFd = fd;
+                return 0;
+            }
+        }
+    }
+
+    double *w = fft_twiddles(size);
+    if(w == NULL){
+        fprintf(stderr, "[%s] Error when allocating memory for twiddle factors\n", prog_name);
+        return EXIT_FAILURE;
+    }
+    twiddles = w;
+    twiddleSize = size;
+    twiddleFile = tmpfile();
+    if(twiddleFile != NULL){
+        if(fwrite(w, sizeof(double), size, twiddleFile) == (size_t) size && fflush(twiddleFile) == 0){
+            twiddleFd = fileno(twiddleFile);
+        } else {
+            fclose(twiddleFile); // the children compute their own factors
+            twiddleFile = NULL;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief frees the twiddle factors of the process tree
+ */
+static void releaseTwiddles(void){
+    if(twiddleMapped > 0) munmap((void *) twiddles, twiddleMapped);
+    else free((void *) twiddles);
+    if(twiddleFile != NULL) fclose(twiddleFile);
+    twiddles = NULL;
+    twiddleFile = NULL;
+    twiddleMapped = 0;
+    twiddleFd = -1;
+}
+
+/**
+ * @brief Rounds a number to zero if it is within a specified tolerance. Also transforms -0 to 0
+ * @detail This function rounds the given double precision number to zero if its absolute value
+ *         is within the specified epsilon tolerance. Otherwise, it returns the original number. It is used for better calculation.
+ * @param number The number to be checked and possibly rounded to zero.
+ * @param epsilon he tolerance for rounding the number to zero.
+ * @return transformed number
+ */
+static double roundToZero(double number, double epsilon) {
+    if (number == (double) -0) {
+        number = (double) 0.0;
+    }
+    if (fabs(number) <= epsilon) {
+        return 0.0; // Return 0 if it's within the epsilon tolerance
+    } else {
+        return number; // Otherwise, return the original number
+    }
+}
+
+/**
+ * @brief Reads result from the children.
+ * @details This function reads the result from a child process through a pipe and inserts into the
+ *          provided array 'R' the real and imaginary parts of the computed values. The data
+ *          is expected to be in the format of alternating real and imaginary parts, each followed
+ *          by a '*i' character. The function returns EXIT_FAILURE on failure with appropriate error messages. Uses prog_name, allocates memory.
+ * @param pipefd pipefds where read end is specified
+ * @param R location where doubles are stored
+ * @return 0 if success, else error
+ */
+static int readSolutionFromChild(int* pipefd, double* R){
+    int sizePipe = 0;
+    if(ioctl(pipefd[0], FIONREAD, &sizePipe) != 0){
+        fprintf(stderr, "[%s] Error: size of pipe is 0\n", prog_name);
+        return EXIT_FAILURE;
+    }
+    char *buffer = (char*) calloc(sizePipe+1, sizeof(char));
+    if(buffer == NULL){
+        fprintf(stderr, "[%s] Error when allocating memory for Result of Children\n", prog_name);
+        return EXIT_FAILURE;
+    }
+    char *endptr = NULL;
+    int counter = 0;
+
+    while(read(pipefd[0], buffer, sizePipe) > 0) {
+        char *str = buffer;
+        while(*str != '\0'){
+            R[counter++] = strtod(str, &endptr); // Real part
+            if(str == endptr) {
+                free(buffer);
+                fprintf(stderr, "[%s] Error on strtod, received faulty result\n", prog_name);
+                return EXIT_FAILURE;
+            }
+            str = endptr;
+            R[counter++] = strtod(str, &endptr); // Imaginary part
+
+            if(str == endptr || *endptr != '*') {
+                free(buffer);
+                fprintf(stderr, "[%s] Error on strtod, received faulty result\n", prog_name);
+                return EXIT_FAILURE;
+            }
+            str = endptr + 2; //skip the "*i" from the imaginary number
+            while(*str == ' ' || *str == '\n') { //go to next number
+                str++;
+            }
+        }
+    }
+    free(buffer);
+    return 0;
+}
+
+/**
+ * @brief Reads the raw result of a child of a process tree with -b.
+ * @details The child writes size/2 complex numbers as real and imaginary part (doubles), see forkFFT. Uses prog_name.
+ * @param pipefd pipefds where read end is specified
+ * @param R location where size doubles are stored
+ * @param size size of the inputs of the parent
+ * @return 0 if success, else error
+ */
+static int readBinaryFromChild(int* pipefd, double* R, int size){
+    size_t bytes = (size_t) size * sizeof(double);
+    if(readAll(pipefd[0], R, bytes) != (ssize_t) bytes){
+        fprintf(stderr, "[%s] Error: received incomplete result from child\n", prog_name);
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+/**
+ * @brief writes buffers completely with writev, continues after partial writes
+ * @param fd file descriptor
+ * @param iov buffers, changed by the call
+ * @param iovcnt number of buffers
+ * @return 0 if success, -1 on error
+ */
+static int writeAll(int fd, struct iovec* iov, int iovcnt){
+    while(iovcnt > 0){
+        ssize_t n = writev(fd, iov, iovcnt);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        while(iovcnt > 0 && (size_t) n >= iov->iov_len){
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if(iovcnt > 0){
+            iov->iov_base = (char*) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief reads until the buffer is full or the end of file is reached
+ * @param fd file descriptor
+ * @param buf buffer
+ * @param bytes size of the buffer
+ * @return number of bytes read, -1 on error
+ */
+static ssize_t readAll(int fd, void* buf, size_t bytes){
+    size_t done = 0;
+    while(done < bytes){
+        ssize_t n = read(fd, (char*) buf + done, bytes - done);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        if(n == 0) break;
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * @brief creates a child with fork and calls the program (recursion) with half the input. See C-T FFT
+ * @details This function creates a child process using fork() and redirects the read end of pipe1 to
+ *         stdin and the write end of pipe2 to stdout in the child process. It then sends the
+ *         input data to the child process + closes the unused ends of the pipes. The function returns
+ *         EXIT_FAILURE on failure with appropriate error messages. Uses prog_name, allocates memory.
+ * @param start start of the location where the doubles of input are stored
+ * @param pipefd1 Parent to Child pipe fd
+ * @param pipefd2 Child to Parent pipe fd
+ * @param size Size of the inputs
+ * @param binary send raw doubles and start the child with -B instead of text
+ * @return 0 if success, else if error
+ */
+static int makeChildRun(double* start, int* pipefd1, int*pipefd2, int size, int binary){
+    int pid;
+    switch (pid = fork()){
+        case -1:
+            // exit
+            fprintf(stderr, "[%s] Error when forking children\n", prog_name);
+            return EXIT_FAILURE;
+        case 0: // child
+            //redirection of pipe1 read end to stdin and pipe2 write end to stdout.
+            close(pipefd1[1]);
+            dup2(pipefd1[0], STDIN_FILENO);
+            close(pipefd1[0]);
+
+            close(pipefd2[0]);
+            dup2(pipefd2[1], STDOUT_FILENO);
+            close(pipefd2[1]);
+
+            // call programm, the twiddle factors are passed on if they are shared
+            char fd[16];
+            snprintf(fd, sizeof(fd), "%d", twiddleFd);
+            if ((twiddleFd >= 0 ? execlp("./forkFFT", "forkFFT", binary ? "-B" : "-f", "-t", fd, NULL)
+                                : execlp("./forkFFT", "forkFFT", binary ? "-B" : "-f", NULL)) == -1) {
+                fprintf(stderr, "[%s] Error when calling execlp. Check if path is right\n", prog_name);
+                return EXIT_FAILURE;
+            }
+        default: // parent
+            // close not used ends
+            close(pipefd1[0]);
+            close(pipefd2[1]);
+
+            if(binary){
+                // number of values and the values in one writev, the strided half is gathered once
+                size_t n = size / 2;
+                double* half = (double *) malloc(n * sizeof(double));
+                if(half == NULL){
+                    fprintf(stderr, "[%s] Error when allocating memory\n", prog_name);
+                    return EXIT_FAILURE;
+                }
+                for (size_t i = 0; i < n; i++) {
+                    half[i] = start[2*i];
+                }
+                struct iovec iov[2] = { { &n, sizeof(n) }, { half, n * sizeof(double) } };
+                int ret = writeAll(pipefd1[1], iov, 2);
+                close(pipefd1[1]);
+                free(half);
+                if(ret != 0){
+                    fprintf(stderr, "[%s] Error when writing input to child\n", prog_name);
+                    return EXIT_FAILURE;
+                }
+                return 0;
+            }
+
+            char* buffer = NULL;
+            int sizeBuffer = 0;
+            int bufferOffset=0;
+            for (int i = 0; i < size; i+=2) {
+                int sizeNum =  snprintf(NULL, 0, "%.10lf\n", start[i]); // snprintf returns the size needed
+                buffer = realloc(buffer, (sizeNum + sizeBuffer + 1) * sizeof(char));
+
+                if(buffer == NULL){
+                    fprintf(stderr, "[%s] Error when reallocating memory\n", prog_name);
+                    return EXIT_FAILURE;
+                }
+                sizeBuffer += sizeNum;
+
+                int length = sprintf(buffer + bufferOffset, "%.10lf\n", start[i]);
+                if (length >= 0) {
+                    bufferOffset += length;
+                } else {
+                    free(buffer);
+                    fprintf(stderr, "[%s] Error when converting double to string\n", prog_name);
+                    return EXIT_FAILURE;
+                }
+            }
+
+            write(pipefd1[1], buffer, sizeBuffer);
+            close(pipefd1[1]);
+            free(buffer);
+            return 0;
+    }
+}
+/**
+ * @brief Helper function for multiplying two imaginary numbers.
+ * @details calculates the real part of a multiplication of two imaginary numbers
+ * @param r1 number 1 real part
+ * @param i1 number 1 imag part
+ * @param r2 number 2 real part
+ * @param i2 number 2 real part
+ * @return real part as a double
+ */
+static double multiplyImaginaryR(double r1, double i1, double r2, double i2){
+    return r1 * r2 - i1 * i2;
+}
+/**
+ * @brief Helper function for multiplying two imaginary numbers.
+ * @details calculates the imaginary part of a multiplication of two imaginary numbers
+ * @param r1 number 1 real part (double)
+ * @param i1 number 1 imag part (double)
+ * @param r2 number 2 real part (double)
+ * @param i2 number 2 real part (double)
+ * @return imaginary part as a double
+ */
+static double multiplyImaginaryI(double r1, double i1, double r2, double i2){
+    return r1 * i2 + i1 * r2;
+}
+
+/**
+ * @brief Prints the Imaginary number with format: [real part] [imag part]*i to the specified output file
+ * @detail This function prints a complex number with the given real and imaginary parts to the specified
+ *         output file. The format of the output is determined by the 'argP' parameter - if 'argP' is non-zero,
+ *         the format is "%.3lf %.3lf*i", otherwise "%.6lf %.6lf*i". it is used for the output of the FFT.
+ * @param r real number (double)
+ * @param i imag number (double)
+ * @param fout File Pointer to out file
+ * @param argP argument P: if true then 3 decimal places, else 6
+ */
+static void printImaginary(double r, double i, FILE* fout, int argP){
+    if (argP)
+        fprintf(fout, "%.3lf %.3lf*i\n", r, i);
+    else
+        fprintf(fout, "%.6lf %.6lf*i\n", r, i); 
+}
@@ -0,0 +1,187 @@
+/**
+ * @file pool.c
+ * @author Luca, xxxxxxxx (exxxxxxxx@student.tuwien.ac.at)
+ * @brief Work-stealing thread pool for fork-join tasks.
+ * @details The queues are small arrays protected by a mutex each: the owner pushes and pops at the tail, thieves take from the head.
+ *          Idle threads look for work in a loop and sleep shortly after every round without success.
+ * @version 0.1
+ * @date 2023-11-06
+ */
+
+#include "pool.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define POOL_SPINS 64 /**< Rounds an idle thread looks for work before it sleeps. */
+#define POOL_NAP_NS 50000 /**< Sleep of an idle thread (50 us). */
+
+/**
+ * @brief Task queue of one thread.
+ */
+typedef struct {
+    pthread_mutex_t mutex; /**< Protects the queue. */
+    pool_task *tasks[POOL_QUEUE]; /**< Tasks from head to tail - 1. */
+    int head; /**< Oldest task. */
+    int tail; /**< One after the newest task. */
+} queue;
+
+/**
+ * @brief A worker thread.
+ */
+typedef struct {
+    pool *p; /**< Pool of the thread. */
+    int index; /**< Index of the thread, the thread that started the pool is 0. */
+    pthread_t thread; /**< Thread id, not used for thread 0. */
+} worker;
+
+struct pool {
+    int nthreads; /**< Number of threads including the calling thread. */
+    queue *queues; /**< Queue of every thread. */
+    worker *workers; /**< Every thread. */
+    int stop; /**< Set (atomically) by pool_stop. */
+};
+
+static __thread int self = -1; /**< index of the calling thread in its pool, -1 outside of a pool */
+
+/**
+ * @brief takes the newest task of the own queue
+ * @param q queue of the calling thread
+ * @return task, NULL if the queue is empty
+ */
+static pool_task *pop(queue *q){
+    pool_task *t = NULL;
+    pthread_mutex_lock(&q->mutex);
+    if(q->tail > q->head) t = q->tasks[--q->tail];
+    if(q->tail == q->head) q->head = q->tail = 0;
+    pthread_mutex_unlock(&q->mutex);
+    return t;
+}
+
+/**
+ * @brief takes the oldest task of another thread
+ * @param p pool
+ * @param thief index of the calling thread
+ * @return task, NULL if every other queue is empty
+ */
+static pool_task *steal(pool *p, int thief){
+    for(int k = 1; k < p->nthreads; k++){
+        queue *q = &p->queues[(thief + k) % p->nthreads];
+        pool_task *t = NULL;
+        pthread_mutex_lock(&q->mutex);
+        if(q->tail > q->head) t = q->tasks[q->head++];
+        if(q->tail == q->head) q->head = q->tail = 0;
+        pthread_mutex_unlock(&q->mutex);
+        if(t != NULL) return t;
+    }
+    return NULL;
+}
+
+/**
+ * @brief runs a task and marks it done
+ * @param t task
+ */
+static void run(pool_task *t){
+    t->fn(t);
+    __atomic_store_n(&t->done, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief sleeps shortly
+ */
+static void nap(void){
+    struct timespec ts = { 0, POOL_NAP_NS };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * @brief thread function of the started threads: steals and runs tasks until the pool stops
+ * @param arg worker
+ * @return NULL
+ */
+static void *work(void *arg){
+    worker *w = arg;
+    self = w->index;
+    int idle = 0;
+    while(!__atomic_load_n(&w->p->stop, __ATOMIC_ACQUIRE)){
+        pool_task *t = pop(&w->p->queues[w->index]);
+        if(t == NULL) t = steal(w->p, w->index);
+        if(t != NULL){
+            run(t);
+            idle = 0;
+        } else if(++idle < POOL_SPINS){
+            sched_yield();
+        } else {
+            nap();
+        }
+    }
+    return NULL;
+}
+
+pool *pool_start(int nthreads){
+    if(nthreads < 1) nthreads = 1;
+    pool *p = malloc(sizeof(pool));
+    if(p == NULL) return NULL;
+    p->nthreads = nthreads;
+    p->stop = 0;
+    p->queues = calloc(nthreads, sizeof(queue));
+    p->workers = calloc(nthreads, sizeof(worker));
+    if(p->queues == NULL || p->workers == NULL){
+        free(p->queues);
+        free(p->workers);
+        free(p);
+        return NULL;
+    }
+    for(int i = 0; i < nthreads; i++){
+        pthread_mutex_init(&p->queues[i].mutex, NULL);
+        p->workers[i].p = p;
+        p->workers[i].index = i;
+    }
+
+    self = 0;
+    for(int i = 1; i < nthreads; i++){
+        if(pthread_create(&p->workers[i].thread, NULL, work, &p->workers[i]) != 0){
+            p->nthreads = i; // the started threads are enough, the queues of the others stay empty
+            break;
+        }
+    }
+    return p;
+}
+
+void pool_spawn(pool *p, pool_task *t, pool_fn fn, void *arg){
+    t->fn = fn;
+    t->arg = arg;
+    t->done = 0;
+    queue *q = &p->queues[self];
+    pthread_mutex_lock(&q->mutex);
+    int full = (q->tail == POOL_QUEUE);
+    if(!full) q->tasks[q->tail++] = t;
+    pthread_mutex_unlock(&q->mutex);
+    if(full) run(t);
+}
+
+void pool_join(pool *p, pool_task *t){
+    int idle = 0;
+    while(!__atomic_load_n(&t->done, __ATOMIC_ACQUIRE)){
+        pool_task *other = pop(&p->queues[self]);
+        if(other == NULL) other = steal(p, self);
+        if(other != NULL){
+            run(other);
+            idle = 0;
+        } else if(++idle < POOL_SPINS){
+            sched_yield();
+        } else {
+            nap();
+        }
+    }
+}
+
+void pool_stop(pool *p){
+    __atomic_store_n(&p->stop, 1, __ATOMIC_RELEASE);
+    for(int i = 1; i < p->nthreads; i++) pthread_join(p->workers[i].thread, NULL);
+    for(int i = 0; i < p->nthreads; i++) pthread_mutex_destroy(&p->queues[i].mutex);
+    free(p->queues);
+    free(p->workers);
+    free(p);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file pool.h
+ * @author Luca, xxxxxxxx (exxxxxxxx@student.tuwien.ac.at)
+ * @brief Work-stealing thread pool for fork-join tasks.
+ * @details Every thread owns a queue of tasks. A thread puts the tasks it spawns into its own queue and takes the newest one
+ *          back when it has nothing to do, an idle thread steals the oldest task of another queue (the biggest piece of work).
+ *          A thread that waits for a task (pool_join) runs other tasks in the meantime, so no thread blocks while there is work.
+ * @version 0.1
+ * @date 2023-11-06
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#define POOL_QUEUE 64 /**< Tasks a queue can hold, a task spawned into a full queue is run right away. */
+
+typedef struct pool pool;
+typedef struct pool_task pool_task;
+
+/**
+ * @brief Function type of a task.
+ * @param t the task, arg holds its parameters
+ */
+typedef void (*pool_fn)(pool_task *t);
+
+/**
+ * @brief A task, owned by the thread that spawns it. It has to stay valid until pool_join returned.
+ */
+struct pool_task {
+    pool_fn fn; /**< Function run by the task. */
+    void *arg; /**< Parameters of the task. */
+    int done; /**< Set (atomically) when fn returned. */
+};
+
+/**
+ * @brief Starts the threads of a pool.
+ * @details The calling thread is the first worker, nthreads - 1 threads are started. It may only spawn and join tasks
+ *          until pool_stop.
+ * @param nthreads number of threads including the calling thread
+ * @return the pool, NULL if memory or the threads could not be allocated
+ */
+pool *pool_start(int nthreads);
+
+/**
+ * @brief Offers a task to the pool. It is run by the calling thread when it joins the task, or by another thread that steals it.
+ * @param p pool
+ * @param t task, set up by the call
+ * @param fn function of the task
+ * @param arg parameters of the task
+ */
+void pool_spawn(pool *p, pool_task *t, pool_fn fn, void *arg);
+
+/**
+ * @brief Waits until a spawned task is done and runs other tasks meanwhile.
+ * @param p pool
+ * @param t task spawned by the calling thread
+ */
+void pool_join(pool *p, pool_task *t);
+
+/**
+ * @brief Stops the threads and frees the pool.
+ * @param p pool from pool_start, every task has to be joined
+ */
+void pool_stop(pool *p);
+
+#endif